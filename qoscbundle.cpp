@@ -36,6 +36,8 @@
 #include <QDebug>
 #include <QLoggingCategory>
 
+#include <string.h>
+
 #include "qoscbundle_p.h"
 #include "qtuio_p.h"
 
@@ -48,11 +50,41 @@ Q_LOGGING_CATEGORY(lcTuioBundle, "qt.qpa.tuio.bundle")
 // Snippets of this specification have been pasted into the source as a means of
 // easily communicating requirements.
 
+QOscBundle::QOscBundle()
+    : m_isValid(false)
+    , m_immediate(false)
+    , m_timeEpoch(0)
+    , m_timePico(0)
+{
+}
+
+// The messages (and nested bundles) point into the packet, which all of them
+// share, so it is kept here. One that is only borrowed, as from
+// QByteArray::fromRawData (the transports parse straight from their buffers;
+// such an array has no capacity of its own), is copied, once for the whole
+// bundle.
 QOscBundle::QOscBundle(const QByteArray &data)
     : m_isValid(false)
     , m_immediate(false)
     , m_timeEpoch(0)
     , m_timePico(0)
+{
+    if (data.capacity() < data.size())
+        parse(QByteArray(data.constData(), data.size()), 0, data.size());
+    else
+        parse(data, 0, data.size());
+}
+
+QOscBundle::QOscBundle(const QByteArray &packet, quint32 offset, quint32 size)
+    : m_isValid(false)
+    , m_immediate(false)
+    , m_timeEpoch(0)
+    , m_timePico(0)
+{
+    parse(packet, offset, size);
+}
+
+void QOscBundle::parse(const QByteArray &data, quint32 offset, quint32 size)
 {
     // 8  16 24 32 40 48 56 64
     // #  b  u  n  d  l  e  \0
@@ -60,18 +92,21 @@ QOscBundle::QOscBundle(const QByteArray &data)
     // 00 00 00 00 00 00 00 01 // osc time-tag, "immediately"
     // 00 00 00 30 // element length
     //      => message or bundle(s), preceded by length each time
-    qCDebug(lcTuioBundle) << data.toHex();
-    quint32 parsedBytes = 0;
+    qCDebug(lcTuioBundle) << data.mid(offset, size).toHex();
+    const quint32 end = offset + size;
+    quint32 parsedBytes = offset;
 
     // "An OSC Bundle consists of the OSC-string "#bundle""
-    QByteArray identifier;
-    if (!qt_readOscString(data, identifier, parsedBytes) || identifier != "#bundle")
+    static const char bundleIdentifier[] = "#bundle"; // with its NULL byte, 8 bytes
+    quint32 identifierLength = 0;
+    if (!qt_skipOscString(data, parsedBytes, end, &identifierLength) || identifierLength != 7 ||
+            memcmp(data.constData() + offset, bundleIdentifier, 7) != 0)
         return;
 
     // "followed by an OSC Time
     // Tag, followed by zero or more OSC Bundle Elements. The OSC-timetag is a
     // 64-bit fixed point time tag whose semantics are described below."
-    if (parsedBytes > (quint32)data.size() || data.size() - parsedBytes < sizeof(quint64))
+    if (parsedBytes > end || end - parsedBytes < sizeof(quint64))
         return;
 
     // "Time tags are represented by a 64 bit fixed point number. The first 32
@@ -97,23 +132,23 @@ QOscBundle::QOscBundle(const QByteArray &data)
         isImmediate = true;
     }
 
-    while (parsedBytes < (quint32)data.size()) {
+    while (parsedBytes < end) {
         // "An OSC Bundle Element consists of its size and its contents. The size is an
         // int32 representing the number of 8-bit bytes in the contents, and will
         // always be a multiple of 4."
         //
         // in practice, a bundle can contain multiple bundles or messages,
         // though, and each is prefixed by a size.
-        if (data.size() - parsedBytes < sizeof(quint32))
+        if (end - parsedBytes < sizeof(quint32))
             return;
 
-        quint32 size = qFromBigEndian<quint32>((const uchar*)data.constData() + parsedBytes);
+        quint32 elementSize = qFromBigEndian<quint32>((const uchar*)data.constData() + parsedBytes);
         parsedBytes += sizeof(quint32);
 
-        if (data.size() - parsedBytes < size)
+        if (end - parsedBytes < elementSize)
             return;
 
-        if (size == 0) {
+        if (elementSize == 0) {
             // empty bundle; these are valid, but should they be allowed? the
             // spec is unclear on this...
             qWarning() << "Empty bundle?";
@@ -126,8 +161,11 @@ QOscBundle::QOscBundle(const QByteArray &data)
 
         // "The contents are either an OSC Message or an OSC Bundle.
         // Note this recursive definition: bundle may contain bundles."
-        QByteArray subdata = data.mid(parsedBytes, size);
-        parsedBytes += size;
+        //
+        // either way, they are parsed where they are, and keep the packet.
+        const quint32 elementOffset = parsedBytes;
+        const char *element = data.constData() + elementOffset;
+        parsedBytes += elementSize;
 
         // "The contents of an OSC packet must be either an OSC Message or an OSC Bundle.
         // The first byte of the packet's contents unambiguously distinguishes between
@@ -135,10 +173,9 @@ QOscBundle::QOscBundle(const QByteArray &data)
         //
         // we're not dealing with a packet here, but the same trick works just
         // the same.
-        QByteArray bundleIdentifier = QByteArray("#bundle\0",  8);
-        if (subdata.startsWith('/')) {
+        if (element[0] == '/') {
             // starts with / => address pattern => start of a message
-            QOscMessage subMessage(subdata);
+            QOscMessage subMessage(data, elementOffset, elementSize);
             if (subMessage.isValid()) {
                 m_isValid = true;
                 m_immediate = isImmediate;
@@ -149,9 +186,9 @@ QOscBundle::QOscBundle(const QByteArray &data)
                 qWarning() << "Invalid sub-message";
                 return;
             }
-        } else if (subdata.startsWith(bundleIdentifier)) {
+        } else if (elementSize >= sizeof(bundleIdentifier) && memcmp(element, bundleIdentifier, sizeof(bundleIdentifier)) == 0) {
             // bundle identifier start => bundle
-            QOscBundle subBundle(subdata);
+            QOscBundle subBundle(data, elementOffset, elementSize);
             if (subBundle.isValid()) {
                 m_isValid = true;
                 m_immediate = isImmediate;
@@ -35,6 +35,8 @@
 #ifndef QOSCBUNDLE_P_H
 #define QOSCBUNDLE_P_H
 
+#include <QMetaType>
+
 #include "qoscmessage_p.h"
 
 QT_BEGIN_NAMESPACE
@@ -42,6 +44,7 @@ QT_BEGIN_NAMESPACE
 class QOscBundle
 {
 public:
+    QOscBundle();
     QOscBundle(const QByteArray &data);
 
     bool isValid() const;
@@ -49,6 +52,9 @@ public:
     QList<QOscMessage> messages() const;
 
 private:
+    QOscBundle(const QByteArray &packet, quint32 offset, quint32 size);
+    void parse(const QByteArray &packet, quint32 offset, quint32 size);
+
     bool m_isValid;
     bool m_immediate;
     quint32 m_timeEpoch;
@@ -59,4 +65,6 @@ private:
 
 QT_END_NAMESPACE
 
+Q_DECLARE_METATYPE(QOscBundle)
+
 #endif // QOSCBUNDLE_P_H
@@ -50,21 +50,42 @@ Q_LOGGING_CATEGORY(lcTuioMessage, "qt.qpa.tuio.message")
 // Snippets of this specification have been pasted into the source as a means of
 // easily communicating requirements.
 
+static inline bool qt_hasOscBytes(quint32 end, quint32 pos, quint32 count)
+{
+    return pos <= end && end - pos >= count;
+}
+
 QOscMessage::QOscMessage(const QByteArray &data)
     : m_isValid(false)
 {
-    qCDebug(lcTuioMessage) << data.toHex();
-    quint32 parsedBytes = 0;
+    parse(data, 0, data.size());
+}
+
+QOscMessage::QOscMessage(const QByteArray &packet, quint32 offset, quint32 size)
+    : m_isValid(false)
+{
+    parse(packet, offset, size);
+}
+
+void QOscMessage::parse(const QByteArray &data, quint32 offset, quint32 size)
+{
+    qCDebug(lcTuioMessage) << data.mid(offset, size).toHex();
+    const quint32 end = offset + size;
+    quint32 parsedBytes = offset;
 
     // "An OSC message consists of an OSC Address Pattern"
     QByteArray addressPattern;
-    if (!qt_readOscString(data, addressPattern, parsedBytes) || addressPattern.size() == 0)
+    if (!qt_readOscString(data, addressPattern, parsedBytes, end) || addressPattern.size() == 0)
         return;
 
     // "followed by an OSC Type Tag String"
-    QByteArray typeTagString;
-    if (!qt_readOscString(data, typeTagString, parsedBytes))
+    //
+    // which is only looked at here, so it is left where it is.
+    const quint32 typeTagOffset = parsedBytes;
+    quint32 typeTagLength = 0;
+    if (!qt_skipOscString(data, parsedBytes, end, &typeTagLength))
         return;
+    const char *typeTagString = data.constData() + typeTagOffset;
 
     // "Note: some older implementations of OSC may omit the OSC Type Tag string.
     // Until all such implementations are updated, OSC implementations should be
@@ -72,51 +93,95 @@ QOscMessage::QOscMessage(const QByteArray &data)
     //
     // (although, the editor notes one may question how exactly the hell one is
     // supposed to be robust when the behavior is unspecified.)
-    if (typeTagString.size() == 0 || typeTagString.at(0) != ',')
+    if (typeTagLength == 0 || typeTagString[0] != ',')
         return;
 
-    QList<QVariant> arguments;
+    QByteArray typeTags;
+    typeTags.reserve(typeTagLength - 1);
+    QVector<Argument> arguments;
+    arguments.reserve(typeTagLength - 1);
 
     // "followed by zero or more OSC Arguments."
-    for (int i = 1; i < typeTagString.size(); ++i) {
-        char typeTag = typeTagString.at(i);
-        if (typeTag == 's') { // osc-string
-            QByteArray aString;
-            if (!qt_readOscString(data, aString, parsedBytes))
+    //
+    // we don't decode anything here, we just remember where each argument is,
+    // so the typed accessors can read it directly out of the data later.
+    for (quint32 i = 1; i < typeTagLength; ++i) {
+        char typeTag = typeTagString[i];
+        Argument argument;
+        argument.offset = parsedBytes;
+        argument.size = 0;
+
+        switch (typeTag) {
+        case 's': // osc-string
+        case 'S': // "Alternate type represented as an OSC-string"
+            if (!qt_skipOscString(data, parsedBytes, end, &argument.size))
                 return;
-            arguments.append(aString);
-        } else if (typeTag == 'i') { // int32
-            if (parsedBytes > (quint32)data.size() || data.size() - parsedBytes < sizeof(quint32))
+            break;
+        case 'b': { // osc-blob
+            // "An int32 size count, followed by that many 8-bit bytes of
+            // arbitrary binary data, followed by 0-3 additional zero bytes to
+            // make the total number of bits a multiple of 32."
+            if (!qt_hasOscBytes(end, parsedBytes, sizeof(quint32)))
                 return;
 
-            quint32 anInt = qFromBigEndian<quint32>((const uchar*)data.constData() + parsedBytes);
+            quint32 blobSize = qFromBigEndian<quint32>((const uchar*)data.constData() + parsedBytes);
             parsedBytes += sizeof(quint32);
 
-            // TODO: is int32 in OSC signed, or unsigned?
-            arguments.append((int)anInt);
-        } else if (typeTag == 'f') { // float32
-            if (parsedBytes > (quint32)data.size() || data.size() - parsedBytes < sizeof(quint32))
+            if (!qt_hasOscBytes(end, parsedBytes, blobSize))
                 return;
 
-            Q_STATIC_ASSERT(sizeof(float) == sizeof(quint32));
-            union {
-                quint32 u;
-                float f;
-            } value;
-            value.u = qFromBigEndian<quint32>((const uchar*)data.constData() + parsedBytes);
+            quint32 paddedSize = blobSize + (4 - blobSize % 4) % 4;
+            if (!qt_hasOscBytes(end, parsedBytes, paddedSize))
+                return;
+
+            argument.offset = parsedBytes;
+            argument.size = blobSize;
+            parsedBytes += paddedSize;
+            break;
+        }
+        case 'i': // int32
+        case 'f': // float32
+        case 'c': // "an ascii character, sent as 32 bits"
+        case 'r': // "32 bit RGBA color"
+        case 'm': // "4 byte MIDI message"
+            if (!qt_hasOscBytes(end, parsedBytes, sizeof(quint32)))
+                return;
+            argument.size = sizeof(quint32);
             parsedBytes += sizeof(quint32);
-            arguments.append(value.f);
-        } else {
+            break;
+        case 'h': // "64 bit big-endian two's complement integer"
+        case 't': // "OSC-timetag"
+        case 'd': // "64 bit ("double") IEEE 754 floating point number"
+            if (!qt_hasOscBytes(end, parsedBytes, sizeof(quint64)))
+                return;
+            argument.size = sizeof(quint64);
+            parsedBytes += sizeof(quint64);
+            break;
+        case 'T': // True
+        case 'F': // False
+        case 'N': // Nil
+        case 'I': // Infinitum (OSC 1.1: "Impulse")
+            // "No bytes are allocated in the argument data."
+            break;
+        case '[': // "Indicates the beginning of an array."
+        case ']': // "Indicates the end of an array."
+            continue;
+        default:
             qWarning() << "Reading argument of unknown type " << typeTag;
             return;
         }
+
+        typeTags.append(typeTag);
+        arguments.append(argument);
     }
 
     m_isValid = true;
+    m_data = data;
     m_addressPattern = addressPattern;
-    m_arguments = arguments;
+    m_typeTags = typeTags;
+    m_argumentData = arguments;
 
-    qCDebug(lcTuioMessage) << "Message with address pattern: " << addressPattern << " arguments: " << arguments;
+    qCDebug(lcTuioMessage) << "Message with address pattern: " << addressPattern << " arguments: " << this->arguments();
 }
 
 bool QOscMessage::isValid() const
@@ -129,9 +194,138 @@ QByteArray QOscMessage::addressPattern() const
     return m_addressPattern;
 }
 
+// Builds the QVariant representation of the arguments. This is the slow path,
+// prefer the typed accessors where possible. Unlike those, strings and blobs
+// are deep copies here, so the list stays valid on its own.
 QList<QVariant> QOscMessage::arguments() const
 {
-    return m_arguments;
+    QList<QVariant> arguments;
+    arguments.reserve(m_typeTags.size());
+
+    for (int i = 0; i < m_typeTags.size(); ++i) {
+        switch (m_typeTags.at(i)) {
+        case 's':
+        case 'S':
+        case 'b':
+        case 'm': {
+            const Argument &argument = m_argumentData.at(i);
+            arguments.append(QByteArray(m_data.constData() + argument.offset, argument.size));
+            break;
+        }
+        case 'i':
+            arguments.append(int32At(i));
+            break;
+        case 'f':
+            arguments.append(floatAt(i));
+            break;
+        case 'c':
+            arguments.append(QChar(uint32At(i)));
+            break;
+        case 'r':
+            arguments.append(uint32At(i));
+            break;
+        case 'h':
+            arguments.append(int64At(i));
+            break;
+        case 't':
+            arguments.append(timeTagAt(i));
+            break;
+        case 'd':
+            arguments.append(doubleAt(i));
+            break;
+        case 'T':
+        case 'F':
+            arguments.append(boolAt(i));
+            break;
+        default: // 'N', 'I'
+            arguments.append(QVariant());
+            break;
+        }
+    }
+
+    return arguments;
+}
+
+const uchar *QOscMessage::argumentData(int index, const char *typeTags) const
+{
+    if (index < 0 || index >= m_typeTags.size() || !qstrchr(typeTags, m_typeTags.at(index)))
+        return 0;
+    return (const uchar*)m_data.constData() + m_argumentData.at(index).offset;
+}
+
+qint32 QOscMessage::int32At(int index) const
+{
+    const uchar *data = argumentData(index, "i");
+    return data ? qFromBigEndian<qint32>(data) : 0;
+}
+
+quint32 QOscMessage::uint32At(int index) const
+{
+    const uchar *data = argumentData(index, "crm");
+    return data ? qFromBigEndian<quint32>(data) : 0;
+}
+
+qint64 QOscMessage::int64At(int index) const
+{
+    const uchar *data = argumentData(index, "h");
+    return data ? qFromBigEndian<qint64>(data) : 0;
+}
+
+quint64 QOscMessage::timeTagAt(int index) const
+{
+    const uchar *data = argumentData(index, "t");
+    return data ? qFromBigEndian<quint64>(data) : 0;
+}
+
+float QOscMessage::floatAt(int index) const
+{
+    const uchar *data = argumentData(index, "f");
+    if (!data)
+        return 0;
+
+    Q_STATIC_ASSERT(sizeof(float) == sizeof(quint32));
+    union {
+        quint32 u;
+        float f;
+    } value;
+    value.u = qFromBigEndian<quint32>(data);
+    return value.f;
+}
+
+double QOscMessage::doubleAt(int index) const
+{
+    const uchar *data = argumentData(index, "d");
+    if (!data)
+        return 0;
+
+    Q_STATIC_ASSERT(sizeof(double) == sizeof(quint64));
+    union {
+        quint64 u;
+        double d;
+    } value;
+    value.u = qFromBigEndian<quint64>(data);
+    return value.d;
+}
+
+bool QOscMessage::boolAt(int index) const
+{
+    return index >= 0 && index < m_typeTags.size() && m_typeTags.at(index) == 'T';
+}
+
+QByteArray QOscMessage::stringAt(int index) const
+{
+    const uchar *data = argumentData(index, "sS");
+    if (!data)
+        return QByteArray();
+    return QByteArray::fromRawData((const char*)data, m_argumentData.at(index).size);
+}
+
+QByteArray QOscMessage::blobAt(int index) const
+{
+    const uchar *data = argumentData(index, "b");
+    if (!data)
+        return QByteArray();
+    return QByteArray::fromRawData((const char*)data, m_argumentData.at(index).size);
 }
 
 QT_END_NAMESPACE
@@ -35,21 +35,63 @@
 #ifndef QOSCMESSAGE_P_H
 #define QOSCMESSAGE_P_H
 
+#include <QByteArray>
+#include <QList>
+#include <QVariant>
+#include <QVector>
+
 QT_BEGIN_NAMESPACE
 
 class QOscMessage
 {
 public:
     QOscMessage(const QByteArray &data);
+    // The message that takes up \a size bytes of \a packet from \a offset on,
+    // as QOscBundle has them. It keeps a reference to the packet rather than
+    // a copy of its part.
+    QOscMessage(const QByteArray &packet, quint32 offset, quint32 size);
     bool isValid() const;
 
     QByteArray addressPattern() const;
     QList<QVariant> arguments() const;
 
+    // Typed access to the arguments, decoding straight from the message data.
+    // Array delimiters ('[' and ']') are not arguments; the arguments they
+    // enclose are flattened into the list. An accessor called on an argument
+    // of a different type returns a default value, so check typeTagAt() (or
+    // typeTags()) first.
+    int argumentCount() const { return m_typeTags.size(); }
+    QByteArray typeTags() const { return m_typeTags; }
+    char typeTagAt(int index) const { return m_typeTags.at(index); }
+
+    qint32 int32At(int index) const;    // 'i'
+    quint32 uint32At(int index) const;  // 'c', 'r', 'm'
+    qint64 int64At(int index) const;    // 'h'
+    quint64 timeTagAt(int index) const; // 't'
+    float floatAt(int index) const;     // 'f'
+    double doubleAt(int index) const;   // 'd'
+    bool boolAt(int index) const;       // 'T', 'F'
+
+    // These return views into the packet the message was parsed from rather
+    // than copies; they are valid for as long as this message (or a copy of
+    // it, or the bundle it came in) is alive.
+    QByteArray stringAt(int index) const; // 's', 'S'
+    QByteArray blobAt(int index) const;   // 'b'
+
 private:
+    struct Argument {
+        quint32 offset;
+        quint32 size;
+    };
+
+    void parse(const QByteArray &packet, quint32 offset, quint32 size);
+    const uchar *argumentData(int index, const char *typeTags) const;
+
     bool m_isValid;
+    QByteArray m_data; // the whole packet; argument offsets are into it
     QByteArray m_addressPattern;
-    QList<QVariant> m_arguments;
+    QByteArray m_typeTags;
+    QVector<Argument> m_argumentData;
 };
 
 QT_END_NAMESPACE
@@ -36,6 +36,7 @@
 
 #include "../qoscbundle_p.h"
 #include "../qoscmessage_p.h"
+#include "../qoscwriter_p.h"
 
 class tst_osc : public QObject
 {
@@ -47,8 +48,16 @@ private slots:
     void brokenBundles();
     void simpleBundle();
     void complexBundle();
+    void allArgumentTypes();
+    void truncatedArguments();
+    void writeSimpleBundle();
+    void writeRoundTrip();
+    void messagesShareThePacket();
+    void messageSlices();
 };
 
+static const char allTypesMessage[] = "2f746573740000002c696673626874645363726d54464e495b695d00fffffffe3f00000068656c6c6f000000000000050102030405000000fffffffed5fa0e0000000001000000023ff400000000000073796d0000000078112233440090407f00000007";
+
 void tst_osc::testBasics()
 {
     QOscBundle bundle = QOscBundle(QByteArray());
@@ -98,6 +107,171 @@ void tst_osc::complexBundle()
     QVERIFY(bundle.isValid());
 }
 
+void tst_osc::allArgumentTypes()
+{
+    // /test ,ifsbhtdScrmTFNI[i]
+    QByteArray payload = QByteArray::fromHex(allTypesMessage);
+
+    QOscMessage message(payload);
+    QVERIFY(message.isValid());
+    QCOMPARE(message.addressPattern(), QByteArray("/test"));
+    QCOMPARE(message.typeTags(), QByteArray("ifsbhtdScrmTFNIi"));
+    QCOMPARE(message.argumentCount(), 16);
+
+    QCOMPARE(message.int32At(0), -2);
+    QCOMPARE(message.floatAt(1), 0.5f);
+    QCOMPARE(message.stringAt(2), QByteArray("hello"));
+    QCOMPARE(message.blobAt(3), QByteArray("\x01\x02\x03\x04\x05"));
+    QCOMPARE(message.int64At(4), Q_INT64_C(-5000000000));
+    QCOMPARE(message.timeTagAt(5), Q_UINT64_C(0x0000000100000002));
+    QCOMPARE(message.doubleAt(6), 1.25);
+    QCOMPARE(message.stringAt(7), QByteArray("sym"));
+    QCOMPARE(message.uint32At(8), quint32('x'));
+    QCOMPARE(message.uint32At(9), quint32(0x11223344));
+    QCOMPARE(message.uint32At(10), quint32(0x0090407f));
+    QCOMPARE(message.boolAt(11), true);
+    QCOMPARE(message.boolAt(12), false);
+    QCOMPARE(message.typeTagAt(13), 'N');
+    QCOMPARE(message.typeTagAt(14), 'I');
+    QCOMPARE(message.int32At(15), 7);
+
+    // blobs are views into the message data, not copies
+    QVERIFY(message.blobAt(3).constData() > payload.constData());
+    QVERIFY(message.blobAt(3).constData() < payload.constData() + payload.size());
+
+    // mismatched accessors don't read anything
+    QCOMPARE(message.int32At(1), 0);
+    QCOMPARE(message.doubleAt(0), 0.0);
+    QVERIFY(message.blobAt(2).isNull());
+
+    QList<QVariant> arguments = message.arguments();
+    QCOMPARE(arguments.count(), 16);
+    QCOMPARE(arguments.at(0).toInt(), -2);
+    QCOMPARE(arguments.at(3).toByteArray(), QByteArray("\x01\x02\x03\x04\x05"));
+    QCOMPARE(arguments.at(4).toLongLong(), Q_INT64_C(-5000000000));
+    QCOMPARE(arguments.at(6).toDouble(), 1.25);
+    QCOMPARE(arguments.at(11).toBool(), true);
+    QVERIFY(!arguments.at(13).isValid());
+}
+
+void tst_osc::truncatedArguments()
+{
+    QByteArray payload = QByteArray::fromHex(allTypesMessage);
+
+    // everything short of the full message must be rejected (without crashing)
+    for (int size = payload.size() - 1; size >= 0; --size) {
+        QOscMessage message(payload.left(size));
+        QVERIFY(!message.isValid());
+    }
+}
+
+void tst_osc::writeSimpleBundle()
+{
+    // the same bytes as in simpleBundle
+    QOscWriter writer;
+    writer.beginBundle();
+    writer.beginMessage("/tuio/2Dcur", "s");
+    writer.addString("alive");
+    writer.endMessage();
+    writer.beginMessage("/tuio/2Dcur", "si");
+    writer.addString("fseq");
+    writer.addInt32(-1);
+    writer.endMessage();
+    writer.endBundle();
+
+    QCOMPARE(writer.data().toHex(), QByteArray("2362756e646c65000000000000000001000000182f7475696f2f3244637572002c730000616c6976650000000000001c2f7475696f2f3244637572002c7369006673657100000000ffffffff"));
+}
+
+void tst_osc::writeRoundTrip()
+{
+    QOscWriter writer;
+
+    // twice, to make sure clear() really starts over
+    for (int i = 0; i < 2; ++i) {
+        writer.clear();
+        writer.beginBundle();
+        writer.beginMessage("/test", "ifsb");
+        writer.addInt32(-2);
+        writer.addFloat(0.5f);
+        writer.addString("four");
+        writer.addBlob(QByteArray("\x01\x02\x03\x04\x05"));
+        writer.endMessage();
+        writer.beginBundle();
+        writer.beginMessage("/nested", "");
+        writer.endMessage();
+        writer.endBundle();
+        writer.endBundle();
+
+        QOscBundle bundle(writer.data());
+        QVERIFY(bundle.isValid());
+        QCOMPARE(bundle.messages().count(), 1);
+        QCOMPARE(bundle.bundles().count(), 1);
+
+        QOscMessage message = bundle.messages().at(0);
+        QCOMPARE(message.addressPattern(), QByteArray("/test"));
+        QCOMPARE(message.typeTags(), QByteArray("ifsb"));
+        QCOMPARE(message.int32At(0), -2);
+        QCOMPARE(message.floatAt(1), 0.5f);
+        QCOMPARE(message.stringAt(2), QByteArray("four"));
+        QCOMPARE(message.blobAt(3), QByteArray("\x01\x02\x03\x04\x05"));
+
+        QCOMPARE(bundle.bundles().at(0).messages().count(), 1);
+        QCOMPARE(bundle.bundles().at(0).messages().at(0).addressPattern(), QByteArray("/nested"));
+    }
+}
+
+void tst_osc::messagesShareThePacket()
+{
+    QOscWriter writer;
+    writer.beginBundle();
+    writer.beginMessage("/first", "s");
+    writer.addString("one");
+    writer.endMessage();
+    writer.beginBundle();
+    writer.beginMessage("/nested", "s");
+    writer.addString("two");
+    writer.endMessage();
+    writer.endBundle();
+    writer.endBundle();
+
+    // borrowed, as the transports hand it over, and gone (or rather,
+    // overwritten) before anything is read from the bundle
+    QByteArray buffer = writer.data();
+    buffer.detach();
+    QOscBundle bundle(QByteArray::fromRawData(buffer.constData(), buffer.size()));
+    buffer.fill('\xff');
+    QVERIFY(bundle.isValid());
+
+    const QByteArray first = bundle.messages().at(0).stringAt(0);
+    const QByteArray nested = bundle.bundles().at(0).messages().at(0).stringAt(0);
+    QCOMPARE(first, QByteArray("one"));
+    QCOMPARE(nested, QByteArray("two"));
+
+    // both point into the one copy of the packet the bundle keeps
+    QVERIFY(nested.constData() > first.constData());
+    QVERIFY(nested.constData() - first.constData() < writer.data().size());
+}
+
+void tst_osc::messageSlices()
+{
+    // a message that is followed by something else in its packet
+    const QByteArray message = QByteArray::fromHex(allTypesMessage);
+    const QByteArray packet = QByteArray("\0\0\0\0", 4) + message + QByteArray("/next\0\0\0,\0\0\0", 12);
+
+    QOscMessage slice(packet, 4, message.size());
+    QVERIFY(slice.isValid());
+    QCOMPARE(slice.addressPattern(), QByteArray("/test"));
+    QCOMPARE(slice.stringAt(2), QByteArray("hello"));
+    QCOMPARE(slice.int32At(15), 7);
+
+    // nothing past the end of the slice may be read, even where the packet
+    // goes on
+    for (int size = message.size() - 1; size >= 0; --size) {
+        QOscMessage truncated(packet, 4, size);
+        QVERIFY(!truncated.isValid());
+    }
+}
+
 QTEST_GUILESS_MAIN(tst_osc)
 
 #include "main.moc"
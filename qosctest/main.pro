@@ -3,6 +3,7 @@ QT += testlib
 SOURCES += \
     main.cpp \
     ../qoscmessage.cpp \
-    ../qoscbundle.cpp
+    ../qoscbundle.cpp \
+    ../qoscwriter.cpp
 
 CONFIG -= app_bundle
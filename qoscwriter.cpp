@@ -0,0 +1,159 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtEndian>
+
+#include <string.h>
+
+#include "qoscwriter_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QOscWriter::QOscWriter(int capacity)
+{
+    // reserving also keeps resize() from giving the memory back
+    m_buffer.reserve(capacity);
+}
+
+void QOscWriter::clear()
+{
+    m_buffer.resize(0);
+    m_elements.clear();
+}
+
+// Appends size bytes, returning where they are.
+inline char *QOscWriter::grow(int size)
+{
+    const int offset = m_buffer.size();
+    m_buffer.resize(offset + size);
+    return m_buffer.data() + offset;
+}
+
+// An OSC-string: the characters, then one to four NULL bytes, so that the
+// total is a multiple of 4.
+void QOscWriter::addPaddedString(const char *string, int size)
+{
+    const int paddedSize = (size + 4) & ~3;
+    char *out = grow(paddedSize);
+    memcpy(out, string, size);
+    memset(out + size, 0, paddedSize - size);
+}
+
+// Bundle elements are preceded by their size, which we only know once
+// they're done.
+void QOscWriter::beginElement()
+{
+    if (m_elements.isEmpty()) {
+        m_elements.append(-1);
+    } else {
+        m_elements.append(m_buffer.size());
+        grow(4);
+    }
+}
+
+void QOscWriter::endElement()
+{
+    Q_ASSERT(!m_elements.isEmpty());
+    const int sizeOffset = m_elements.last();
+    m_elements.removeLast();
+
+    if (sizeOffset >= 0) {
+        const quint32 size = m_buffer.size() - sizeOffset - 4;
+        qToBigEndian<quint32>(size, reinterpret_cast<uchar *>(m_buffer.data() + sizeOffset));
+    }
+}
+
+void QOscWriter::beginBundle(quint64 timeTag)
+{
+    beginElement();
+    addPaddedString("#bundle", 7);
+    qToBigEndian<quint64>(timeTag, reinterpret_cast<uchar *>(grow(8)));
+}
+
+void QOscWriter::endBundle()
+{
+    endElement();
+}
+
+void QOscWriter::beginMessage(const char *addressPattern, const char *typeTags)
+{
+    beginElement();
+    addPaddedString(addressPattern, int(strlen(addressPattern)));
+
+    const int size = int(strlen(typeTags)) + 1;
+    const int paddedSize = (size + 4) & ~3;
+    char *out = grow(paddedSize);
+    out[0] = ',';
+    memcpy(out + 1, typeTags, size - 1);
+    memset(out + size, 0, paddedSize - size);
+}
+
+void QOscWriter::endMessage()
+{
+    endElement();
+}
+
+void QOscWriter::addInt32(qint32 value)
+{
+    qToBigEndian<qint32>(value, reinterpret_cast<uchar *>(grow(4)));
+}
+
+void QOscWriter::addFloat(float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    qToBigEndian<quint32>(bits, reinterpret_cast<uchar *>(grow(4)));
+}
+
+void QOscWriter::addString(const char *string)
+{
+    addPaddedString(string, int(strlen(string)));
+}
+
+void QOscWriter::addString(const QByteArray &string)
+{
+    addPaddedString(string.constData(), string.size());
+}
+
+void QOscWriter::addBlob(const QByteArray &blob)
+{
+    addInt32(blob.size());
+
+    const int paddedSize = (blob.size() + 3) & ~3;
+    char *out = grow(paddedSize);
+    memcpy(out, blob.constData(), blob.size());
+    memset(out + blob.size(), 0, paddedSize - blob.size());
+}
+
+QT_END_NAMESPACE
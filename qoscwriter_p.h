@@ -0,0 +1,87 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QOSCWRITER_P_H
+#define QOSCWRITER_P_H
+
+#include <QByteArray>
+#include <QVarLengthArray>
+
+QT_BEGIN_NAMESPACE
+
+// Serializes OSC messages and bundles (the counterpart of QOscMessage and
+// QOscBundle). Everything is written into one buffer, which is kept around
+// between packets, so once it has grown to the size of a typical packet,
+// writing one doesn't allocate.
+//
+// Arguments must be added in the order, and of the types, given to
+// beginMessage; that isn't checked.
+class QOscWriter
+{
+public:
+    explicit QOscWriter(int capacity = 1024);
+
+    // Starts over with an empty packet, keeping the buffer.
+    void clear();
+    const QByteArray &data() const { return m_buffer; }
+
+    // Bundles may be nested. A time tag of 1 means "immediately".
+    void beginBundle(quint64 timeTag = 1);
+    void endBundle();
+
+    // typeTags without the leading ','.
+    void beginMessage(const char *addressPattern, const char *typeTags);
+    void endMessage();
+
+    void addInt32(qint32 value);               // 'i'
+    void addFloat(float value);                // 'f'
+    void addString(const char *string);        // 's', 'S'
+    void addString(const QByteArray &string);
+    void addBlob(const QByteArray &blob);      // 'b'
+
+private:
+    char *grow(int size);
+    void addPaddedString(const char *string, int size);
+    void beginElement();
+    void endElement();
+
+    QByteArray m_buffer;
+    // for every bundle or message not ended yet: where its size goes, or -1
+    // if it isn't inside a bundle
+    QVarLengthArray<int, 4> m_elements;
+};
+
+QT_END_NAMESPACE
+
+#endif // QOSCWRITER_P_H
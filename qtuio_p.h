@@ -35,13 +35,29 @@
 #ifndef QTUIO_P_H
 #define QTUIO_P_H
 
+#include <QByteArray>
+
+#include <string.h>
+
 QT_BEGIN_NAMESPACE
 
-inline bool qt_readOscString(const QByteArray &source, QByteArray &dest, quint32 &pos)
+// Strings are looked for between \a pos and \a limit (an offset into \a
+// source), so that they can be read from a part of a packet.
+inline int qt_findOscStringEnd(const QByteArray &source, quint32 pos, quint32 limit)
+{
+    if (limit > quint32(source.size()))
+        limit = source.size();
+    if (pos >= limit)
+        return -1;
+    const char *end = static_cast<const char *>(memchr(source.constData() + pos, '\0', limit - pos));
+    return end ? int(end - source.constData()) : -1;
+}
+
+inline bool qt_readOscString(const QByteArray &source, QByteArray &dest, quint32 &pos, quint32 limit)
 {
-    int end = source.indexOf('\0', pos);
+    int end = qt_findOscStringEnd(source, pos, limit);
     if (end < 0) {
-        pos = source.size();
+        pos = limit;
         dest = QByteArray();
         return false;
     }
@@ -57,6 +73,26 @@ inline bool qt_readOscString(const QByteArray &source, QByteArray &dest, quint32
     return true;
 }
 
+// Like qt_readOscString, but does not copy the string out of \a source; it
+// only advances \a pos past it, and optionally reports its length (without
+// the terminating NULL byte).
+inline bool qt_skipOscString(const QByteArray &source, quint32 &pos, quint32 limit, quint32 *length = 0)
+{
+    int end = qt_findOscStringEnd(source, pos, limit);
+    if (end < 0) {
+        pos = limit;
+        return false;
+    }
+
+    if (length)
+        *length = end - pos;
+
+    end += 4 - ((end - pos) % 4);
+
+    pos = end;
+    return true;
+}
+
 QT_END_NAMESPACE
 
 #endif
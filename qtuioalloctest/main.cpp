@@ -0,0 +1,361 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <stdlib.h>
+
+#include <QtTest>
+#include <QGuiApplication>
+#include <QTemporaryDir>
+#include <QTouchEvent>
+#include <QWindow>
+
+#include <qpa/qwindowsysteminterface.h>
+
+#include "../qoscbundle_p.h"
+#include "../qoscwriter_p.h"
+#include "../qtuiohandler_p.h"
+#include "../qtuiostats_p.h"
+#include "../qtuiotrace_p.h"
+
+// Counts the heap allocations made while a steady stream of frames (the same
+// cursors, all of them moving) goes through the parser and the handler, stage
+// by stage, and fails if a stage goes over its budget in any frame once warmed
+// up. Allocations are counted by interposing malloc and friends, which only
+// works with glibc.
+
+#if defined(__GLIBC__)
+#define QTUIO_COUNT_ALLOCATIONS
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+}
+
+// only what the measuring thread does counts, and thread locals don't need
+// the heap (in an executable, that is).
+static __thread bool tl_counting = false;
+static __thread int tl_allocations = 0;
+static __thread int tl_frees = 0;
+
+extern "C" void *malloc(size_t size)
+{
+    if (tl_counting)
+        ++tl_allocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    if (tl_counting)
+        ++tl_allocations;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    if (tl_counting)
+        ++tl_allocations;
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer)
+{
+    if (tl_counting && pointer)
+        ++tl_frees;
+    __libc_free(pointer);
+}
+#endif
+
+struct AllocationCount
+{
+    AllocationCount() : allocations(0), frees(0) {}
+
+    int allocations;
+    int frees;
+};
+
+static void beginCounting()
+{
+#if defined(QTUIO_COUNT_ALLOCATIONS)
+    tl_allocations = 0;
+    tl_frees = 0;
+    tl_counting = true;
+#endif
+}
+
+static void endCounting(AllocationCount *total)
+{
+#if defined(QTUIO_COUNT_ALLOCATIONS)
+    tl_counting = false;
+    total->allocations += tl_allocations;
+    total->frees += tl_frees;
+#else
+    Q_UNUSED(total);
+#endif
+}
+
+class TouchWindow : public QWindow
+{
+protected:
+    void touchEvent(QTouchEvent *event)
+    {
+        event->accept();
+    }
+};
+
+enum Message {
+    Alive = 0x1,
+    Set = 0x2,
+    Fseq = 0x4
+};
+
+// A TUIO 1.1 2Dcur bundle with some (or all) of the messages of a frame, with
+// the cursors spread out along a line that moves up and down every frame.
+static QByteArray tuioBundle(int cursorCount, int frameId, int messages)
+{
+    QOscWriter writer;
+    writer.beginBundle();
+
+    if (messages & Alive) {
+        QByteArray typeTags("s");
+        typeTags += QByteArray(cursorCount, 'i');
+        writer.beginMessage("/tuio/2Dcur", typeTags.constData());
+        writer.addString("alive");
+        for (int i = 0; i < cursorCount; ++i)
+            writer.addInt32(i + 1);
+        writer.endMessage();
+    }
+
+    if (messages & Set) {
+        for (int i = 0; i < cursorCount; ++i) {
+            writer.beginMessage("/tuio/2Dcur", "sifffff");
+            writer.addString("set");
+            writer.addInt32(i + 1);
+            writer.addFloat((i + 1) / float(cursorCount + 2));
+            writer.addFloat(frameId % 2 ? 0.25f : 0.75f);
+            writer.addFloat(0);
+            writer.addFloat(0);
+            writer.addFloat(0);
+            writer.endMessage();
+        }
+    }
+
+    if (messages & Fseq) {
+        writer.beginMessage("/tuio/2Dcur", "si");
+        writer.addString("fseq");
+        writer.addInt32(frameId);
+        writer.endMessage();
+    }
+
+    writer.endBundle();
+    return writer.data();
+}
+
+class tst_allocations : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void bundleReceived(quint64 sourceId, const QOscBundle &bundle, const QTuioPacketTimes &times);
+
+private slots:
+    void initTestCase();
+    void steadyState_data();
+    void steadyState();
+};
+
+void tst_allocations::initTestCase()
+{
+#if !defined(QTUIO_COUNT_ALLOCATIONS)
+    QSKIP("Counting allocations needs glibc");
+#endif
+}
+
+void tst_allocations::steadyState_data()
+{
+    QTest::addColumn<int>("cursorCount");
+
+    QTest::newRow("1 cursor") << 1;
+    QTest::newRow("10 cursors") << 10;
+    QTest::newRow("40 cursors") << 40;
+}
+
+void tst_allocations::steadyState()
+{
+    QFETCH(int, cursorCount);
+    const int warmup = 50; // to get the cursors pressed, and buffers grown
+    const int frames = 200;
+
+    TouchWindow window;
+    window.setGeometry(0, 0, 400, 400);
+    window.show();
+    window.requestActivate();
+    QVERIFY(QTest::qWaitForWindowActive(&window));
+
+    // bundles are handed to the handler directly, as a transport would; it
+    // just needs to listen somewhere that isn't in the way.
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QTuioHandler handler(QStringLiteral("unix=") + dir.path() + QStringLiteral("/tuio"));
+    QVERIFY(connect(this, SIGNAL(bundleReceived(quint64,QOscBundle,QTuioPacketTimes)),
+                    &handler, SLOT(processBundle(quint64,QOscBundle,QTuioPacketTimes))));
+
+    // the same number of touch points, handed to Qt directly every frame on
+    // a device of our own, to tell what Qt allocates itself
+    QTouchDevice *device = new QTouchDevice; // not leaked, QTouchDevice cleans up registered devices itself
+    device->setType(QTouchDevice::TouchScreen);
+    device->setCapabilities(QTouchDevice::Position | QTouchDevice::Area | QTouchDevice::NormalizedPosition);
+    QWindowSystemInterface::registerTouchDevice(device);
+    QList<QWindowSystemInterface::TouchPoint> referencePoints;
+    for (int i = 0; i < cursorCount; ++i) {
+        QWindowSystemInterface::TouchPoint tp;
+        tp.id = i + 1;
+        tp.state = Qt::TouchPointPressed;
+        tp.pressure = 1.0;
+        referencePoints.append(tp);
+    }
+
+    // what the list of messages of a bundle costs to grow to its size
+    // (QList<QOscMessage> grows just like a list of pointers)
+    AllocationCount listGrowth;
+    const int messageCount = cursorCount + 2;
+    {
+        QList<void *> list;
+        beginCounting();
+        for (int i = 0; i < messageCount; ++i)
+            list.append(0);
+        endCounting(&listGrowth);
+    }
+
+    // parsing a whole frame (as the transports do, from their buffer), then
+    // handling its ALIVE, SETs and FSEQ (which includes handing the touch
+    // event to Qt), each in a bundle of its own so they can be told apart.
+    enum Stage { Parse, AliveStage, SetStage, FseqStage, StageCount };
+    const char *const stageNames[StageCount] = { "parse", "alive", "set", "fseq" };
+    AllocationCount totals[StageCount];
+
+    for (int frame = 0; frame < warmup + frames; ++frame) {
+        AllocationCount counts[StageCount];
+
+        const QByteArray packet = tuioBundle(cursorCount, frame, Alive | Set | Fseq);
+        beginCounting();
+        {
+            QOscBundle bundle(QByteArray::fromRawData(packet.constData(), packet.size()));
+            QVERIFY(bundle.isValid());
+        }
+        endCounting(&counts[Parse]);
+
+        const QOscBundle bundles[3] = {
+            QOscBundle(tuioBundle(cursorCount, frame, Alive)),
+            QOscBundle(tuioBundle(cursorCount, frame, Set)),
+            QOscBundle(tuioBundle(cursorCount, frame, Fseq))
+        };
+
+        QTuioPacketTimes times;
+        times.received = qt_tuioTimestamp();
+        for (int i = 0; i < 3; ++i) {
+            beginCounting();
+            emit bundleReceived(1, bundles[i], times);
+            endCounting(&counts[AliveStage + i]);
+        }
+
+        for (int i = 0; i < cursorCount; ++i) {
+            QWindowSystemInterface::TouchPoint &tp = referencePoints[i];
+            tp.normalPosition = QPointF((i + 1) / qreal(cursorCount + 2), frame % 2 ? 0.25 : 0.75);
+            tp.area = QRectF(0, 0, 1, 1);
+            tp.area.moveCenter(QPointF(400 * tp.normalPosition.x(), 400 * tp.normalPosition.y()));
+            if (frame > 0)
+                tp.state = Qt::TouchPointMoved;
+        }
+        AllocationCount qtCount;
+        beginCounting();
+        QWindowSystemInterface::handleTouchEvent(&window, device, referencePoints);
+        endCounting(&qtCount);
+
+        // deliver it all, which isn't ours to count
+        QWindowSystemInterface::flushWindowSystemEvents();
+
+        if (frame < warmup)
+            continue;
+
+        // what each stage allocates, every single frame:
+        const int budgets[StageCount] = {
+            // the raw QByteArray header of the packet and the one copy the
+            // bundle keeps of it, and for each message: its address pattern,
+            // its type tags and argument offsets, its node in the list of
+            // messages; and the list growing
+            2 + 4 * messageCount + listGrowth.allocations,
+            // only the message type (a raw QByteArray header), as no cursor
+            // comes or goes
+            1,
+            // the message type of every SET
+            cursorCount,
+            // the message type, the touch point list and a node for each
+            // point in it, and whatever Qt itself makes of them
+            2 + cursorCount + qtCount.allocations
+        };
+
+        for (int i = 0; i < StageCount; ++i) {
+            QVERIFY2(counts[i].allocations <= budgets[i],
+                     qPrintable(QStringLiteral("%1 allocates %2 times in frame %3, over its budget of %4")
+                                .arg(QLatin1String(stageNames[i])).arg(counts[i].allocations).arg(frame)
+                                .arg(budgets[i])));
+            totals[i].allocations += counts[i].allocations;
+            totals[i].frees += counts[i].frees;
+        }
+    }
+
+    // the averages, for tuning the budgets; only with QTUIO_ALLOCATION_REPORT
+    // set, as they are the same in every run
+    if (qEnvironmentVariableIsSet("QTUIO_ALLOCATION_REPORT")) {
+        for (int i = 0; i < StageCount; ++i) {
+            qDebug("%d cursors, %s: %.1f allocations, %.1f frees per frame", cursorCount, stageNames[i],
+                   totals[i].allocations / qreal(frames), totals[i].frees / qreal(frames));
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // no display or touch hardware needed
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    tst_allocations test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "main.moc"
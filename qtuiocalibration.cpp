@@ -0,0 +1,155 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QFile>
+#include <QDebug>
+
+#include "qtuiocalibration_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// Finds where in a quad (top left, top right, bottom left, bottom right) a
+// point is, as the s and t it is bilinearly interpolated with. There's no
+// neat closed form that holds up for all quads, so Newton's method it is.
+// For points outside of the quad, s and t end up outside of [0, 1].
+static bool qt_inverseBilinear(const QPointF *quad, const QPointF &point, qreal *s, qreal *t)
+{
+    const QPointF a = quad[1] - quad[0];
+    const QPointF b = quad[2] - quad[0];
+    const QPointF c = quad[0] - quad[1] - quad[2] + quad[3];
+
+    *s = 0.5;
+    *t = 0.5;
+    for (int i = 0; i < 16; ++i) {
+        const QPointF f = quad[0] + a * *s + b * *t + c * (*s * *t) - point;
+        if (f.x() * f.x() + f.y() * f.y() < 1e-18)
+            return true;
+
+        // the Jacobian's columns, d/ds and d/dt
+        const QPointF ds = a + c * *t;
+        const QPointF dt = b + c * *s;
+        const qreal determinant = ds.x() * dt.y() - dt.x() * ds.y();
+        if (qFuzzyIsNull(determinant))
+            return false;
+
+        *s -= (dt.y() * f.x() - dt.x() * f.y()) / determinant;
+        *t -= (ds.x() * f.y() - ds.y() * f.x()) / determinant;
+    }
+
+    return false;
+}
+
+// The file lists the number of columns and rows of targets, then for each
+// target (row by row, from the top left), the normalized x and y the tracker
+// reported for it. Everything after a # is a comment.
+bool QTuioCalibrationMesh::load(const QString &fileName, int size)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Failed to read TUIO calibration from " << fileName << ": " << file.errorString();
+        return false;
+    }
+
+    QVector<qreal> values;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        const QList<QByteArray> fields = line.left(line.indexOf('#')).simplified().split(' ');
+        foreach (const QByteArray &field, fields) {
+            if (field.isEmpty())
+                continue;
+            bool ok = false;
+            values.append(field.toDouble(&ok));
+            if (!ok) {
+                qWarning() << "Malformed TUIO calibration " << fileName << ": bad value " << field;
+                return false;
+            }
+        }
+    }
+
+    const int columns = values.size() >= 2 ? int(values.at(0)) : 0;
+    const int rows = values.size() >= 2 ? int(values.at(1)) : 0;
+    if (columns < 2 || rows < 2 || values.size() != 2 + columns * rows * 2) {
+        qWarning() << "Malformed TUIO calibration " << fileName << ": expected at least 2x2 targets, and a position for each";
+        return false;
+    }
+
+    QVector<QPointF> grid(columns * rows);
+    for (int i = 0; i < grid.size(); ++i)
+        grid[i] = QPointF(values.at(2 + i * 2), values.at(3 + i * 2));
+
+    // for every node of the table, find the quad of the grid it is in (or
+    // the one it is the least outside of), and where in it.
+    size = qMax(2, size);
+    QVector<Node> table(size * size);
+    for (int row = 0; row < size; ++row) {
+        for (int column = 0; column < size; ++column) {
+            const QPointF point(qreal(column) / (size - 1), qreal(row) / (size - 1));
+            qreal bestDistance = -1;
+            QPointF best;
+
+            for (int quadRow = 0; quadRow < rows - 1 && bestDistance != 0; ++quadRow) {
+                for (int quadColumn = 0; quadColumn < columns - 1 && bestDistance != 0; ++quadColumn) {
+                    const int topLeft = quadRow * columns + quadColumn;
+                    const QPointF quad[4] = { grid.at(topLeft), grid.at(topLeft + 1),
+                                              grid.at(topLeft + columns), grid.at(topLeft + columns + 1) };
+                    qreal s;
+                    qreal t;
+                    if (!qt_inverseBilinear(quad, point, &s, &t))
+                        continue;
+
+                    const qreal distance = qMax(qreal(0), qMax(-s, s - 1)) + qMax(qreal(0), qMax(-t, t - 1));
+                    if (bestDistance < 0 || distance < bestDistance) {
+                        bestDistance = distance;
+                        best = QPointF((quadColumn + s) / (columns - 1), (quadRow + t) / (rows - 1));
+                    }
+                }
+            }
+
+            if (bestDistance < 0) {
+                qWarning() << "Malformed TUIO calibration " << fileName << ": the targets don't form a grid";
+                return false;
+            }
+
+            Node &node = table[row * size + column];
+            node.x = float(best.x());
+            node.y = float(best.y());
+        }
+    }
+
+    m_size = size;
+    m_table = table;
+    return true;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,101 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOCALIBRATION_P_H
+#define QTUIOCALIBRATION_P_H
+
+#include <QPointF>
+#include <QString>
+#include <QVector>
+#include <QtMath>
+
+QT_BEGIN_NAMESPACE
+
+// Non-linear correction (keystone, lens distortion, tiles that don't quite
+// line up) of normalized positions, see the calibration option.
+//
+// It is measured as a grid of targets spread evenly over the display, with
+// the position the tracker reported for each (after rotation, inversion and
+// the calibration matrix, if any). That grid is inverted once, on loading,
+// into a dense table of where positions (evenly spaced this time) reported
+// by the tracker belong on the display, so that correcting a point takes
+// just a bilinear lookup.
+class QTuioCalibrationMesh
+{
+public:
+    QTuioCalibrationMesh() : m_size(0) {}
+
+    bool load(const QString &fileName, int size = 128);
+    bool isNull() const { return m_size == 0; }
+
+    // Corrects a frame's worth of points in place. Points outside of the
+    // table are extrapolated from its outermost cells.
+    void map(QPointF *points, int count) const
+    {
+        const int last = m_size - 1;
+        const Node *table = m_table.constData();
+
+        for (int i = 0; i < count; ++i) {
+            const qreal fx = points[i].x() * last;
+            const qreal fy = points[i].y() * last;
+            const int column = qBound(0, qFloor(fx), last - 1);
+            const int row = qBound(0, qFloor(fy), last - 1);
+            const float u = float(fx - column);
+            const float v = float(fy - row);
+
+            const Node *topLeft = table + row * m_size + column;
+            const Node *bottomLeft = topLeft + m_size;
+            const float topX = topLeft[0].x + (topLeft[1].x - topLeft[0].x) * u;
+            const float topY = topLeft[0].y + (topLeft[1].y - topLeft[0].y) * u;
+            const float bottomX = bottomLeft[0].x + (bottomLeft[1].x - bottomLeft[0].x) * u;
+            const float bottomY = bottomLeft[0].y + (bottomLeft[1].y - bottomLeft[0].y) * u;
+
+            points[i].setX(topX + (bottomX - topX) * v);
+            points[i].setY(topY + (bottomY - topY) * v);
+        }
+    }
+
+private:
+    struct Node {
+        float x;
+        float y;
+    };
+
+    int m_size; // nodes per row and column
+    QVector<Node> m_table;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOCALIBRATION_P_H
@@ -39,21 +39,79 @@
 
 QT_BEGIN_NAMESPACE
 
+// What QTuioOneEuroFilter needs to remember about a cursor between frames.
+struct QTuioFilterState
+{
+    QTuioFilterState()
+        : initialized(false), rawX(0), rawY(0), x(0), y(0), dx(0), dy(0), timestamp(0)
+    {
+    }
+
+    bool initialized;
+    float rawX; // the last position the tracker sent
+    float rawY;
+    float x;    // the filtered position
+    float y;
+    float dx;   // the filtered speed
+    float dy;
+    qint64 timestamp;
+};
+
+// The last few positions of a cursor, and the velocity and acceleration
+// derived from them, see qt_tuioUpdateMotion.
+struct QTuioMotionState
+{
+    enum { Size = 5 };
+
+    QTuioMotionState()
+        : count(0), newest(Size - 1), vx(0), vy(0), acceleration(0)
+    {
+    }
+
+    float x[Size]; // a ring, newest is the last one written
+    float y[Size];
+    qint64 timestamp[Size];
+    int count;     // how many of them are filled in yet
+    int newest;
+    float vx;      // in normalized units per second, like the tracker's
+    float vy;
+    float acceleration;
+};
+
 class QTuioCursor
 {
 public:
-    QTuioCursor(int id = -1)
+    // The TUIO profile a cursor is sent with. Session IDs are unique across
+    // all profiles of a tracker, so they all share one set of cursors, but
+    // each profile's ALIVE only covers its own.
+    enum Profile {
+        Cursor2D,  // /tuio/2Dcur
+        Cursor25D, // /tuio/25Dcur, z is the height above the surface
+        Cursor3D,  // /tuio/3Dcur
+        Object3D   // /tuio/3Dobj, only its position is used
+    };
+
+    QTuioCursor(int id = -1, Profile profile = Cursor2D)
         : m_id(id)
+        , m_profile(profile)
         , m_x(0)
         , m_y(0)
+        , m_z(0)
         , m_vx(0)
         , m_vy(0)
+        , m_vz(0)
         , m_acceleration(0)
         , m_state(Qt::TouchPointPressed)
+        , m_deliveredX(0)
+        , m_deliveredY(0)
+        , m_deliveredZ(0)
+        , m_moving(false)
+        , m_hovering(false)
     {
     }
 
     int id() const { return m_id; }
+    Profile profile() const { return m_profile; }
 
     void setX(float x)
     {
@@ -75,26 +133,64 @@ public:
     }
     float y() const { return m_y; }
 
+    // Unlike x and y, z doesn't mark the cursor as moved by itself, see the
+    // hover option.
+    void setZ(float z) { m_z = z; }
+    float z() const { return m_z; }
+
     void setVX(float vx) { m_vx = vx; }
     float vx() const { return m_vx; }
 
     void setVY(float vy) { m_vy = vy; }
     float vy() const { return m_vy; }
 
+    void setVZ(float vz) { m_vz = vz; }
+    float vz() const { return m_vz; }
+
     void setAcceleration(float acceleration) { m_acceleration = acceleration; }
     float acceleration() const { return m_acceleration; }
 
     void setState(const Qt::TouchPointState &state) { m_state = state; }
     Qt::TouchPointState state() const { return m_state; }
 
+    // Where the cursor was when it was last delivered in a touch event, and
+    // whether it was moving at the time; used to filter out jitter.
+    void setDelivered() { m_deliveredX = m_x; m_deliveredY = m_y; m_deliveredZ = m_z; }
+    float deliveredX() const { return m_deliveredX; }
+    float deliveredY() const { return m_deliveredY; }
+    float deliveredZ() const { return m_deliveredZ; }
+
+    void setMoving(bool moving) { m_moving = moving; }
+    bool isMoving() const { return m_moving; }
+
+    // Hovering cursors are too far above the surface to be touches; they
+    // aren't delivered at all.
+    void setHovering(bool hovering) { m_hovering = hovering; }
+    bool isHovering() const { return m_hovering; }
+
+    QTuioFilterState &filterState() { return m_filterState; }
+
+    QTuioMotionState &motionState() { return m_motionState; }
+    const QTuioMotionState &motionState() const { return m_motionState; }
+
 private:
     int m_id;
+    Profile m_profile;
     float m_x;
     float m_y;
+    float m_z;
     float m_vx;
     float m_vy;
+    float m_vz;
     float m_acceleration;
     Qt::TouchPointState m_state;
+    float m_deliveredX;
+    float m_deliveredY;
+    float m_deliveredZ;
+    bool m_moving;
+    bool m_hovering;
+    QTuioFilterState m_filterState;
+    QTuioMotionState m_motionState;
 };
 
 QT_END_NAMESPACE
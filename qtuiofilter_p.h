@@ -0,0 +1,140 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOFILTER_P_H
+#define QTUIOFILTER_P_H
+
+#include <qmath.h>
+
+#include "qtuiocursor_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// How close (in normalized units) to its real position a filtered cursor has
+// to be to count as settled there.
+static const qreal qt_tuioFilterSettled = 1e-4;
+
+// The "One Euro" filter (Casiez, Roussel, Vogel: "1€ Filter: A Simple
+// Speed-based Low-pass Filter for Noisy Input in Interactive Systems", CHI
+// 2012): a low-pass filter whose cutoff frequency goes up with speed, so that
+// a slow or resting cursor is smoothed a lot (no jitter), while a fast one is
+// barely smoothed at all (no lag).
+//
+// minCutoff (in Hz) is the cutoff at rest; beta how quickly the cutoff goes up
+// with speed (in normalized units per second); derivativeCutoff (in Hz) that
+// of the low-pass filter applied to the speed itself.
+class QTuioOneEuroFilter
+{
+public:
+    QTuioOneEuroFilter(qreal minCutoff = 1.0, qreal beta = 10.0, qreal derivativeCutoff = 1.0)
+        : m_minCutoff(minCutoff)
+        , m_beta(beta)
+        , m_derivativeCutoff(derivativeCutoff)
+    {
+    }
+
+    // Filters the cursor's position, as of timestamp (see qt_tuioTimestamp).
+    // Cursors the tracker didn't move this frame are still filtered until they
+    // have settled at their last real position; after that, they are left
+    // alone (and stationary) until the tracker moves them again.
+    void filter(QTuioCursor &cursor, qint64 timestamp) const
+    {
+        QTuioFilterState &state = cursor.filterState();
+
+        if (!state.initialized || cursor.state() == Qt::TouchPointPressed) {
+            state.initialized = true;
+            state.rawX = cursor.x();
+            state.rawY = cursor.y();
+            state.x = state.rawX;
+            state.y = state.rawY;
+            state.dx = 0;
+            state.dy = 0;
+            state.timestamp = timestamp;
+            return;
+        }
+
+        // a SET with the same position as before marks the cursor as moved
+        // (from where it was filtered to), so compare with the last raw one.
+        const bool rawMoved = cursor.state() == Qt::TouchPointMoved &&
+                (cursor.x() != state.rawX || cursor.y() != state.rawY);
+        if (!rawMoved && qAbs(state.rawX - state.x) < qt_tuioFilterSettled && qAbs(state.rawY - state.y) < qt_tuioFilterSettled) {
+            cursor.setX(state.x);
+            cursor.setY(state.y);
+            cursor.setState(Qt::TouchPointStationary);
+            state.dx = 0;
+            state.dy = 0;
+            state.timestamp = timestamp;
+            return;
+        }
+
+        if (rawMoved) {
+            state.rawX = cursor.x();
+            state.rawY = cursor.y();
+        }
+
+        qreal dt = (timestamp - state.timestamp) / 1e9;
+        if (dt <= 0)
+            dt = 1.0 / 60; // same frame, or no timestamps: assume a typical rate
+        state.timestamp = timestamp;
+
+        const qreal previousX = state.x;
+        const qreal previousY = state.y;
+
+        const qreal derivativeAlpha = alpha(m_derivativeCutoff, dt);
+        state.dx += derivativeAlpha * ((state.rawX - previousX) / dt - state.dx);
+        state.dy += derivativeAlpha * ((state.rawY - previousY) / dt - state.dy);
+
+        const qreal speed = qSqrt(state.dx * state.dx + state.dy * state.dy);
+        const qreal positionAlpha = alpha(m_minCutoff + m_beta * speed, dt);
+        state.x = previousX + positionAlpha * (state.rawX - previousX);
+        state.y = previousY + positionAlpha * (state.rawY - previousY);
+        cursor.setX(state.x);
+        cursor.setY(state.y);
+    }
+
+private:
+    static qreal alpha(qreal cutoff, qreal dt)
+    {
+        const qreal tau = 1.0 / (2 * M_PI * cutoff);
+        return 1.0 / (1.0 + tau / dt);
+    }
+
+    qreal m_minCutoff;
+    qreal m_beta;
+    qreal m_derivativeCutoff;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOFILTER_P_H
@@ -0,0 +1,168 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QDebug>
+
+#if defined(Q_OS_UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#else
+#include <QUdpSocket>
+#endif
+
+#include "qtuioforwarder_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QTuioForwarder::QTuioForwarder()
+    : m_opened(false)
+#if defined(Q_OS_UNIX)
+    , m_socket4(-1)
+    , m_socket6(-1)
+#else
+    , m_socket(0)
+#endif
+{
+}
+
+void QTuioForwarder::setDestinations(const QTuioEndpointList &destinations)
+{
+    Q_ASSERT(!m_opened);
+    m_destinations = destinations;
+}
+
+#if defined(Q_OS_UNIX)
+
+QTuioForwarder::~QTuioForwarder()
+{
+    if (m_socket4 >= 0)
+        ::close(m_socket4);
+    if (m_socket6 >= 0)
+        ::close(m_socket6);
+}
+
+static int qt_openForwardSocket(int family)
+{
+    int fd = ::socket(family, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        qWarning() << "Failed to create TUIO forwarding socket: " << qt_error_string(errno);
+        return -1;
+    }
+
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+bool QTuioForwarder::open()
+{
+    m_opened = true;
+    m_addresses.resize(m_destinations.size() * sizeof(sockaddr_storage));
+    m_addresses.fill(0);
+    sockaddr_storage *addresses = reinterpret_cast<sockaddr_storage *>(m_addresses.data());
+
+    for (int i = 0; i < m_destinations.size(); ++i) {
+        const QHostAddress &address = m_destinations.at(i).first;
+        const quint16 port = m_destinations.at(i).second;
+
+        if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+            sockaddr_in6 *sa = reinterpret_cast<sockaddr_in6 *>(&addresses[i]);
+            sa->sin6_family = AF_INET6;
+            sa->sin6_port = htons(port);
+            Q_IPV6ADDR ipv6 = address.toIPv6Address();
+            memcpy(&sa->sin6_addr, &ipv6, sizeof(ipv6));
+            if (m_socket6 < 0)
+                m_socket6 = qt_openForwardSocket(AF_INET6);
+        } else {
+            sockaddr_in *sa = reinterpret_cast<sockaddr_in *>(&addresses[i]);
+            sa->sin_family = AF_INET;
+            sa->sin_port = htons(port);
+            sa->sin_addr.s_addr = htonl(address.toIPv4Address());
+            if (m_socket4 < 0)
+                m_socket4 = qt_openForwardSocket(AF_INET);
+        }
+    }
+
+    return m_socket4 >= 0 || m_socket6 >= 0;
+}
+
+void QTuioForwarder::forward(const char *data, qint64 size)
+{
+    if (m_destinations.isEmpty() || (!m_opened && !open()))
+        return;
+
+    const sockaddr_storage *addresses = reinterpret_cast<const sockaddr_storage *>(m_addresses.constData());
+    for (int i = 0; i < m_destinations.size(); ++i) {
+        const bool ipv6 = addresses[i].ss_family == AF_INET6;
+        const int fd = ipv6 ? m_socket6 : m_socket4;
+        if (fd < 0)
+            continue;
+
+        // a full socket buffer, or nobody listening (ECONNREFUSED from an
+        // earlier send) just mean this packet doesn't make it
+        ::sendto(fd, data, size_t(size), MSG_DONTWAIT, reinterpret_cast<const sockaddr *>(&addresses[i]),
+                 ipv6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in));
+    }
+}
+
+#else
+
+QTuioForwarder::~QTuioForwarder()
+{
+    delete m_socket;
+}
+
+bool QTuioForwarder::open()
+{
+    m_opened = true;
+    m_socket = new QUdpSocket;
+    return true;
+}
+
+void QTuioForwarder::forward(const char *data, qint64 size)
+{
+    if (m_destinations.isEmpty() || (!m_opened && !open()))
+        return;
+
+    for (int i = 0; i < m_destinations.size(); ++i)
+        m_socket->writeDatagram(data, size, m_destinations.at(i).first, m_destinations.at(i).second);
+}
+
+#endif
+
+QT_END_NAMESPACE
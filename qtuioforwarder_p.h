@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOFORWARDER_P_H
+#define QTUIOFORWARDER_P_H
+
+#include <QHostAddress>
+#include <QPair>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QUdpSocket;
+
+typedef QVector<QPair<QHostAddress, quint16> > QTuioEndpointList;
+
+// Sends packets on to a list of UDP destinations, as they are: one send (and
+// so, one copy into the kernel) per destination. Sending never blocks; a
+// destination that can't keep up loses packets, rather than holding us up.
+//
+// The socket is only opened on the first send, so that it belongs to the
+// thread that forwards.
+class QTuioForwarder
+{
+public:
+    QTuioForwarder();
+    ~QTuioForwarder();
+
+    void setDestinations(const QTuioEndpointList &destinations);
+    bool isEmpty() const { return m_destinations.isEmpty(); }
+
+    void forward(const char *data, qint64 size);
+
+private:
+    Q_DISABLE_COPY(QTuioForwarder)
+
+    bool open();
+
+    QTuioEndpointList m_destinations;
+    bool m_opened;
+#if defined(Q_OS_UNIX)
+    // the destinations as sockaddrs, converted once up front
+    QByteArray m_addresses;
+    int m_socket4;
+    int m_socket6;
+#else
+    QUdpSocket *m_socket;
+#endif
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOFORWARDER_P_H
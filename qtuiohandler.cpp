@@ -33,38 +33,301 @@
 ****************************************************************************/
 
 #include <QLoggingCategory>
+#include <QNetworkInterface>
+#include <QHostAddress>
+#include <QPair>
 #include <QRect>
 #include <QWindow>
 #include <QGuiApplication>
+#include <QThread>
+#include <QTimer>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 #include <qpa/qwindowsysteminterface.h>
+#include <qpa/qwindowsysteminterface_p.h>
 
 #include "qtuiocursor_p.h"
 #include "qtuiohandler_p.h"
 #include "qoscbundle_p.h"
+#include "qtuioudptransport_p.h"
+#include "qtuioshmtransport_p.h"
+#include "qtuiosliptransport_p.h"
+#include "qtuiounixtransport_p.h"
+#include "qtuiopacketfilter_p.h"
+#include "qtuiowindowindex_p.h"
 
 QT_BEGIN_NAMESPACE
 
 Q_LOGGING_CATEGORY(lcTuioSource, "qt.qpa.tuio.source")
 Q_LOGGING_CATEGORY(lcTuioSet, "qt.qpa.tuio.set")
+Q_LOGGING_CATEGORY(lcTuioStats, "qt.qpa.tuio.stats")
+
+static QTouchDevice *qt_createTuioDevice(const QString &name)
+{
+    QTouchDevice *device = new QTouchDevice; // not leaked, QTouchDevice cleans up registered devices itself
+    device->setName(name);
+    device->setType(QTouchDevice::TouchScreen);
+    device->setCapabilities(QTouchDevice::Position |
+                            QTouchDevice::Area |
+                            QTouchDevice::Velocity |
+                            QTouchDevice::NormalizedPosition);
+    QWindowSystemInterface::registerTouchDevice(device);
+    return device;
+}
+
+// Parses one entry of the udp= list: either just a port, or address@port. The
+// address is left null if not given, see bind=.
+static bool qt_parseTuioEndpoint(const QString &entry, QHostAddress *address, quint16 *port)
+{
+    QString portString = entry;
+    address->clear();
+
+    if (entry.contains('@')) {
+        if (!address->setAddress(entry.section('@', 0, 0)))
+            return false;
+        portString = entry.section('@', 1, 1);
+    }
+
+    bool ok = false;
+    *port = portString.toUShort(&ok);
+    return ok;
+}
+
+// Leaves out the forwarding destinations that are one of our own udp=
+// endpoints, which would send every packet back to us, over and over. Ours are
+// the address bound to, or with a wildcard one, any address of this host.
+static QTuioEndpointList qt_withoutOwnEndpoints(const QTuioEndpointList &destinations,
+                                                const QVector<QPair<QHostAddress, quint16> > &endpoints)
+{
+    QTuioEndpointList result;
+    QList<QHostAddress> hostAddresses; // only looked up when needed
+
+    foreach (const QTuioEndpointList::value_type &destination, destinations) {
+        const QHostAddress &address = destination.first;
+        bool own = false;
+        for (int i = 0; !own && i < endpoints.count(); ++i) {
+            const QHostAddress &bound = endpoints.at(i).first;
+            if (endpoints.at(i).second != destination.second)
+                continue;
+
+            if (bound == QHostAddress::Any || bound == QHostAddress::AnyIPv4 || bound == QHostAddress::AnyIPv6) {
+                if (hostAddresses.isEmpty())
+                    hostAddresses = QNetworkInterface::allAddresses();
+                own = hostAddresses.contains(address) || address.isInSubnet(QHostAddress(QHostAddress::LocalHost), 8);
+            } else {
+                own = bound == address;
+            }
+        }
+
+        if (own)
+            qWarning() << "Ignoring TUIO forwarding destination " << address.toString() << destination.second << ", we listen there ourselves";
+        else
+            result.append(destination);
+    }
+
+    return result;
+}
 
 QTuioHandler::QTuioHandler(const QString &specification)
-    : m_device(new QTouchDevice) // not leaked, QTouchDevice cleans up registered devices itself
+    : m_device(qt_createTuioDevice(QStringLiteral("TUIO")))
+    , m_sourceCount(0)
+    , m_sourceTimer(new QTimer(this))
+    , m_windowIndex(0)
+    , m_movementThreshold(0)
+    , m_movementThresholdInPixels(false)
+    , m_smoothing(false)
+    , m_kinematics(SenderKinematics)
+    , m_hoverHeight(0)
+    , m_backpressureThreshold(0)
+    , m_backpressureTimer(new QTimer(this))
+    , m_immediate(false)
+    , m_immediateTimer(new QTimer(this))
+    , m_trace(0)
+    , m_traceFrame(0)
+    , m_forwardedFrame(0)
+    , m_snapshot(0)
+    , m_seamDistance(0.02)
+    , m_seamTimeout(50)
+    , m_stitchTimer(new QTimer(this))
 {
     QStringList args = specification.split(':');
-    int portNumber = 3333;
+    QVector<QPair<QHostAddress, quint16> > endpoints;
+    int socketsPerPort = 1;
+    QHostAddress bindAddress(QHostAddress::Any);
+    QTuioSocketOptions socketOptions;
     int rotationAngle = 0;
     bool invertx = false;
     bool inverty = false;
+    QTransform calibration;
+    QTuioPacketFilter filter;
+    QString shmName;
+    QStringList unixPaths;
+    QStringList streamPaths;
+    QTuioEndpointList forwardDestinations;
+    QTuioEndpointList mappedDestinations;
+    int shmSize = 1 << 20;
 
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i).startsWith("udp=")) {
-            QString portString = args.at(i).section('=', 1, 1);
-            portNumber = portString.toInt();
-        } else if (args.at(i).startsWith("tcp=")) {
-            QString portString = args.at(i).section('=', 1, 1);
-            portNumber = portString.toInt();
-            qWarning() << "TCP is not yet supported. Falling back to UDP on " << portNumber;
+        if (args.at(i).startsWith("udp=") || args.at(i).startsWith("tcp=")) {
+            if (args.at(i).startsWith("tcp="))
+                qWarning() << "TCP is not yet supported. Falling back to UDP on " << args.at(i).section('=', 1, 1);
+
+            QStringList entries = args.at(i).section('=', 1, 1).split(',');
+            foreach (const QString &entry, entries) {
+                QHostAddress address;
+                quint16 port;
+                if (qt_parseTuioEndpoint(entry, &address, &port))
+                    endpoints.append(qMakePair(address, port));
+                else
+                    qWarning() << "Ignoring malformed TUIO endpoint " << entry;
+            }
+        } else if (args.at(i).startsWith("shm=")) {
+            // name of the shared memory segment, and optionally its size
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            shmName = values.at(0);
+            if (values.count() > 1)
+                shmSize = values.at(1).toInt();
+        } else if (args.at(i).startsWith("unix=")) {
+            unixPaths += args.at(i).section('=', 1, 1).split(',', QString::SkipEmptyParts);
+        } else if (args.at(i).startsWith("fifo=")) {
+            // named pipes, or - for stdin
+            streamPaths += args.at(i).section('=', 1, 1).split(',', QString::SkipEmptyParts);
+        } else if (args.at(i).startsWith("forward=") || args.at(i).startsWith("forwardmapped=")) {
+            // ports (on this host) or address@port entries, see
+            // QTuioForwarder and forwardFrame
+            QTuioEndpointList destinations;
+            QStringList entries = args.at(i).section('=', 1, 1).split(',');
+            foreach (const QString &entry, entries) {
+                QHostAddress address;
+                quint16 port;
+                if (qt_parseTuioEndpoint(entry, &address, &port))
+                    destinations.append(qMakePair(address.isNull() ? QHostAddress(QHostAddress::LocalHost) : address, port));
+                else
+                    qWarning() << "Ignoring malformed TUIO forwarding destination " << entry;
+            }
+
+            if (args.at(i).startsWith("forward="))
+                forwardDestinations = destinations;
+            else
+                mappedDestinations = destinations;
+        } else if (args.at(i).startsWith("tile=")) {
+            // port or address@port of the tracker, then x,y,width,height of
+            // its tile in the stitched surface (all normalized)
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            Tile tile;
+            bool ok = values.count() == 5 && qt_parseTuioEndpoint(values.at(0), &tile.address, &tile.port);
+            qreal rect[4];
+            for (int j = 0; ok && j < 4; ++j)
+                rect[j] = values.at(j + 1).toDouble(&ok);
+            if (ok && rect[2] > 0 && rect[3] > 0) {
+                tile.rect = QRectF(rect[0], rect[1], rect[2], rect[3]);
+                m_tiles.append(tile);
+            } else {
+                qWarning() << "Ignoring malformed TUIO tile " << args.at(i);
+            }
+        } else if (args.at(i).startsWith("seam=")) {
+            // how close (normalized) a touch leaving one tile must be to one
+            // entering the next, and optionally, how long it may take (ms)
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            m_seamDistance = qMax(0.0, values.at(0).toDouble());
+            if (values.count() > 1)
+                m_seamTimeout = qMax(0, values.at(1).toInt());
+        } else if (args.at(i).startsWith("allow=")) {
+            QStringList entries = args.at(i).section('=', 1, 1).split(',');
+            foreach (const QString &entry, entries) {
+                if (!filter.addAllowedSender(entry))
+                    qWarning() << "Ignoring malformed TUIO sender " << entry;
+            }
+        } else if (args.at(i).startsWith("ratelimit=")) {
+            // packets per second, and optionally how many may arrive in a
+            // burst (by default, a second's worth)
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            int rate = values.at(0).toInt();
+            int burst = values.count() > 1 ? values.at(1).toInt() : rate;
+            filter.setRateLimit(rate, burst);
+        } else if (args.at(i).startsWith("bind=")) {
+            if (!bindAddress.setAddress(args.at(i).section('=', 1, 1))) {
+                qWarning() << "Ignoring malformed TUIO bind address " << args.at(i);
+                bindAddress = QHostAddress::Any;
+            }
+        } else if (args.at(i).startsWith("iface=")) {
+            socketOptions.interfaceName = args.at(i).section('=', 1, 1).toLocal8Bit();
+        } else if (args.at(i).startsWith("rcvbuf=")) {
+            socketOptions.receiveBufferSize = qMax(0, args.at(i).section('=', 1, 1).toInt());
+        } else if (args.at(i).startsWith("busypoll=")) {
+            socketOptions.busyPoll = qMax(0, args.at(i).section('=', 1, 1).toInt());
+        } else if (args.at(i).startsWith("reuseport=")) {
+            QString countString = args.at(i).section('=', 1, 1);
+            socketsPerPort = qMax(1, countString.toInt());
+        } else if (args.at(i) == "screen" || args.at(i).startsWith("screen=")) {
+            QString screenSpec = args.at(i).section('=', 1, 1);
+            delete m_windowIndex;
+            m_windowIndex = new QTuioWindowIndex(screenSpec, this);
+        } else if (args.at(i).startsWith("threshold=")) {
+            QString thresholdString = args.at(i).section('=', 1, 1);
+            m_movementThresholdInPixels = thresholdString.endsWith("px");
+            if (m_movementThresholdInPixels)
+                thresholdString.chop(2);
+            m_movementThreshold = qMax(0.0, thresholdString.toDouble());
+        } else if (args.at(i) == "smooth" || args.at(i).startsWith("smooth=")) {
+            // minimum cutoff (Hz), beta, and derivative cutoff (Hz) of the
+            // One Euro filter, see QTuioOneEuroFilter.
+            QStringList values = args.at(i).section('=', 1, 1).split(',', QString::SkipEmptyParts);
+            qreal parameters[3] = { 1.0, 10.0, 1.0 };
+            bool ok = values.count() <= 3;
+            for (int j = 0; ok && j < values.count(); ++j)
+                parameters[j] = values.at(j).toDouble(&ok);
+            if (ok && parameters[0] > 0 && parameters[1] >= 0 && parameters[2] > 0) {
+                m_smoothing = true;
+                m_smoothingFilter = QTuioOneEuroFilter(parameters[0], parameters[1], parameters[2]);
+            } else {
+                qWarning() << "Ignoring malformed TUIO smoothing parameters " << args.at(i);
+            }
+        } else if (args.at(i) == "kinematics") {
+            m_kinematics = DerivedIfMissing;
+        } else if (args.at(i) == "kinematics=always") {
+            // for trackers whose velocities can't be trusted at all
+            m_kinematics = DerivedKinematics;
+        } else if (args.at(i).startsWith("matrix=")) {
+            // m11,m12,m21,m22,dx,dy of an affine QTransform, applied to
+            // normalized coordinates after any rotation and inversion.
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            bool ok = values.count() == 6;
+            qreal m[6];
+            for (int j = 0; ok && j < 6; ++j)
+                m[j] = values.at(j).toDouble(&ok);
+            if (ok)
+                calibration = QTransform(m[0], m[1], m[2], m[3], m[4], m[5]);
+            else
+                qWarning() << "Ignoring malformed TUIO calibration matrix " << args.at(i);
+        } else if (args.at(i).startsWith("calibration=")) {
+            // file with the calibration grid, and optionally how many nodes
+            // per row and column its lookup table gets
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            int size = values.count() > 1 ? values.at(1).toInt() : 128;
+            if (!m_calibrationMesh.load(values.at(0), qBound(2, size, 1024)))
+                qWarning() << "Ignoring TUIO calibration " << values.at(0);
+        } else if (args.at(i).startsWith("hover=")) {
+            // how high above the surface (normalized, as the z of the 2.5D
+            // and 3D profiles) a cursor may be and still touch
+            m_hoverHeight = qMax(0.0, args.at(i).section('=', 1, 1).toDouble());
+        } else if (args.at(i).startsWith("trace=")) {
+            // file name, and optionally how many frames to keep
+            QStringList values = args.at(i).section('=', 1, 1).split(',');
+            int frames = values.count() > 1 ? values.at(1).toInt() : 4096;
+            m_traceFileName = values.at(0);
+            delete m_trace;
+            m_trace = new QTuioTrace(qMax(1, frames));
+        } else if (args.at(i).startsWith("backpressure=")) {
+            QString thresholdString = args.at(i).section('=', 1, 1);
+            m_backpressureThreshold = qMax(0, thresholdString.toInt());
+        } else if (args.at(i) == "snapshot") {
+            if (!m_snapshot)
+                m_snapshot = new QTuioSnapshotBuffer;
+        } else if (args.at(i) == "immediate") {
+            m_immediate = true;
         } else if (args.at(i) == "invertx") {
             invertx = true;
         } else if (args.at(i) == "inverty") {
@@ -83,254 +346,1249 @@ QTuioHandler::QTuioHandler(const QString &specification)
         }
     }
 
-    if (rotationAngle)
-        m_transform = QTransform::fromTranslate(0.5, 0.5).rotate(rotationAngle).translate(-0.5, -0.5);
+    if (endpoints.isEmpty() && shmName.isEmpty() && unixPaths.isEmpty() && streamPaths.isEmpty())
+        endpoints.append(qMakePair(QHostAddress(), quint16(3333)));
 
-    if (invertx)
-        m_transform *= QTransform::fromTranslate(0.5, 0.5).scale(-1.0, 1.0).translate(-0.5, -0.5);
+    for (int i = 0; i < endpoints.count(); ++i) {
+        if (endpoints.at(i).first.isNull())
+            endpoints[i].first = bindAddress;
+    }
 
-    if (inverty)
-        m_transform *= QTransform::fromTranslate(0.5, 0.5).scale(1.0, -1.0).translate(-0.5, -0.5);
+    forwardDestinations = qt_withoutOwnEndpoints(forwardDestinations, endpoints);
+    m_forwarder.setDestinations(qt_withoutOwnEndpoints(mappedDestinations, endpoints));
 
-    m_device->setName("TUIO"); // TODO: multiple based on SOURCE?
-    m_device->setType(QTouchDevice::TouchScreen);
-    m_device->setCapabilities(QTouchDevice::Position |
-                              QTouchDevice::Area |
-                              QTouchDevice::Velocity |
-                              QTouchDevice::NormalizedPosition);
-    QWindowSystemInterface::registerTouchDevice(m_device);
+    if (calibration.isIdentity()) {
+        m_mapFunction = qt_tuioMapFunction(rotationAngle, invertx, inverty);
+    } else {
+        // a calibration matrix can be anything, so fold rotation and
+        // inversion into it, and map through the matrix.
+        if (rotationAngle)
+            m_transform = QTransform::fromTranslate(0.5, 0.5).rotate(rotationAngle).translate(-0.5, -0.5);
 
-    if (!m_socket.bind(QHostAddress::Any, portNumber)) {
-        qWarning() << "Failed to bind TUIO socket: " << m_socket.errorString();
-        return;
+        if (invertx)
+            m_transform *= QTransform::fromTranslate(0.5, 0.5).scale(-1.0, 1.0).translate(-0.5, -0.5);
+
+        if (inverty)
+            m_transform *= QTransform::fromTranslate(0.5, 0.5).scale(1.0, -1.0).translate(-0.5, -0.5);
+
+        m_transform *= calibration;
+        m_mapFunction = qt_tuioMapPointsGeneric;
+    }
+
+    qRegisterMetaType<QOscBundle>();
+    qRegisterMetaType<QTuioPacketTimes>();
+    qRegisterMetaType<QTuioSenderAddress>();
+    socketOptions.reusePort = socketsPerPort > 1;
+
+    m_sourceTimer->start(1000);
+    connect(m_sourceTimer, &QTimer::timeout, this, &QTuioHandler::expireSources);
+
+    // with reuseport=N, every port is served by N sockets, each drained (and
+    // its datagrams parsed) on a thread of its own. the kernel keeps each
+    // sender address and port on the same socket, and each of those is a
+    // source of its own, so every source is still processed in order; it all
+    // comes together again in processBundle, on our thread.
+    //
+    // otherwise, there's one socket per port, living on our thread, as do
+    // the other transports, except for those that block waiting for packets.
+    QVector<QTuioTransport *> transports;
+    QStringList threadNames; // empty for our thread
+
+    for (int i = 0; i < endpoints.count(); ++i) {
+        for (int j = 0; j < socketsPerPort; ++j) {
+            transports.append(new QTuioUdpTransport(endpoints.at(i).first, endpoints.at(i).second, socketOptions,
+                                                    filter, &m_stats));
+            threadNames.append(socketsPerPort > 1 ? QStringLiteral("TUIO receiver %1/%2").arg(endpoints.at(i).second).arg(j)
+                                                  : QString());
+        }
+    }
+
+    if (!shmName.isEmpty()) {
+        transports.append(new QTuioShmTransport(shmName, shmSize, filter, &m_stats));
+        threadNames.append(QStringLiteral("TUIO receiver %1").arg(shmName));
+    }
+
+    foreach (const QString &path, unixPaths) {
+        transports.append(new QTuioUnixTransport(path, filter, &m_stats));
+        threadNames.append(QString());
+    }
+
+    foreach (const QString &path, streamPaths) {
+        transports.append(new QTuioSlipTransport(path, filter, &m_stats));
+        threadNames.append(QString());
+    }
+
+    for (int i = 0; i < transports.size(); ++i) {
+        QTuioTransport *transport = transports.at(i);
+        connect(transport, &QTuioTransport::sourceAdded, this, &QTuioHandler::addSource);
+        connect(transport, &QTuioTransport::bundleReceived, this, &QTuioHandler::processBundle);
+        transport->setTracing(m_trace != 0);
+        transport->setForwardDestinations(forwardDestinations);
+
+        if (!threadNames.at(i).isEmpty() || transport->isBlocking()) {
+            QThread *thread = new QThread(this);
+            thread->setObjectName(threadNames.at(i));
+            transport->moveToThread(thread);
+            connect(thread, &QThread::started, transport, &QTuioTransport::start);
+            connect(thread, &QThread::finished, transport, &QObject::deleteLater);
+            m_threads.append(thread);
+            thread->start();
+        } else {
+            transport->setParent(this);
+            transport->start();
+        }
     }
 
-    connect(&m_socket, &QUdpSocket::readyRead, this, &QTuioHandler::processPackets);
+    if (m_hoverHeight > 0)
+        m_device->setCapabilities(m_device->capabilities() | QTouchDevice::Pressure);
+
+    m_stitched.device = m_device;
+    m_stitchTimer->setSingleShot(true);
+    connect(m_stitchTimer, &QTimer::timeout, this, &QTuioHandler::flushStitchedFrame);
+
+    m_backpressureTimer->setInterval(4);
+    connect(m_backpressureTimer, &QTimer::timeout, this, &QTuioHandler::flushPendingFrames);
+
+    m_immediateTimer->setSingleShot(true);
+    connect(m_immediateTimer, &QTimer::timeout, this, &QTuioHandler::flushImmediateFrames);
+
+    if (lcTuioStats().isDebugEnabled()) {
+        QTimer *statsTimer = new QTimer(this);
+        connect(statsTimer, &QTimer::timeout, this, &QTuioHandler::logStatistics);
+        statsTimer->start(5000);
+    }
+
+    if (m_trace) {
+        // so the application can get at writeTrace
+        setObjectName(QStringLiteral("TuioTouch"));
+        qApp->setProperty("_q_tuioTouch", QVariant::fromValue<QObject *>(this));
+    }
+
+    // see qt_tuioSnapshotBuffer
+    if (m_snapshot)
+        qApp->setProperty("_q_tuioSnapshot", QVariant::fromValue<quintptr>(quintptr(m_snapshot)));
+}
+
+void QTuioHandler::logStatistics()
+{
+    qCDebug(lcTuioStats) << "datagrams:" << m_stats.datagrams.load()
+                         << "bundles:" << m_stats.bundles.load()
+                         << "rejected (sender):" << m_stats.rejectedSender.load()
+                         << "rejected (malformed):" << m_stats.rejectedMalformed.load()
+                         << "rejected (rate):" << m_stats.rejectedRate.load()
+                         << "invalid bundles:" << m_stats.invalidBundles.load()
+                         << "kernel drops:" << m_stats.kernelDrops.load()
+                         << "queue depth:" << m_stats.queueDepth.load()
+                         << "max queue depth:" << m_stats.maxQueueDepth.load()
+                         << "dropped frames:" << m_stats.droppedFrames.load()
+                         << "dispatch latency (us):" << m_stats.dispatchLatency.load()
+                         << "average:" << m_stats.averageDispatchLatency.load()
+                         << "max:" << m_stats.maxDispatchLatency.load()
+                         << "delivery latency (us):" << m_stats.deliveryLatency.load()
+                         << "average:" << m_stats.averageDeliveryLatency.load()
+                         << "max:" << m_stats.maxDeliveryLatency.load();
 }
 
 QTuioHandler::~QTuioHandler()
 {
+    foreach (QThread *thread, m_threads) {
+        thread->requestInterruption();
+        thread->quit();
+        thread->wait();
+    }
+
+    if (m_trace) {
+        writeTrace();
+        delete m_trace;
+    }
+
+    if (m_snapshot) {
+        qApp->setProperty("_q_tuioSnapshot", QVariant());
+        delete m_snapshot;
+    }
+}
+
+bool QTuioHandler::writeTrace(const QString &fileName)
+{
+    if (!m_trace) {
+        qWarning() << "TUIO tracing is not enabled, use the trace option";
+        return false;
+    }
+
+    return m_trace->write(fileName.isEmpty() ? m_traceFileName : fileName);
 }
 
-void QTuioHandler::processPackets()
+// A sender on the network, announced by its transport before its first
+// bundle: the one place its address is known, so it is matched against the
+// tiles here.
+void QTuioHandler::addSource(quint64 sourceId, const QTuioSenderAddress &sender, quint16 port)
 {
-    while (m_socket.hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(m_socket.pendingDatagramSize());
-        QHostAddress sender;
-        quint16 senderPort;
+    const QHostAddress address = sender.toHostAddress();
+    for (int i = 0; i < m_tiles.size(); ++i) {
+        const Tile &tile = m_tiles.at(i);
+        if (tile.port == port && (tile.address.isNull() || tile.address == address)) {
+            source(sourceId, tile.rect);
+            return;
+        }
+    }
+}
 
-        qint64 size = m_socket.readDatagram(datagram.data(), datagram.size(),
-                                             &sender, &senderPort);
+QTuioHandler::Source &QTuioHandler::source(quint64 sourceId, const QRectF &tile)
+{
+    QHash<quint64, Source>::Iterator it = m_sources.find(sourceId);
+    if (it == m_sources.end()) {
+        Source source;
+        source.index = m_sourceCount++;
+        source.tile = tile;
+        source.timestamp = qt_tuioTimestamp();
 
-        if (size == -1)
-            continue;
+        // the first one gets the device we registered up front, so a single
+        // tracker setup looks just like it always did. tiles are delivered
+        // as part of the stitched surface, which has that device as well.
+        // others get one of their own, one an expired source left, if any
+        // (devices can't be unregistered).
+        bool deviceTaken = false;
+        foreach (const Source &other, m_sources)
+            deviceTaken = deviceTaken || (other.device == m_device && other.tile.isNull());
+        if (!deviceTaken || !source.tile.isNull()) {
+            source.device = m_device;
+        } else if (!m_spareDevices.isEmpty()) {
+            source.device = m_spareDevices.takeLast();
+        } else {
+            source.device = qt_createTuioDevice(QStringLiteral("TUIO %1").arg(source.index));
+            if (m_hoverHeight > 0)
+                source.device->setCapabilities(source.device->capabilities() | QTouchDevice::Pressure);
+        }
+
+        it = m_sources.insert(sourceId, source);
+    }
 
-        if (size != datagram.size())
-            datagram.resize(size);
+    return *it;
+}
 
-        QOscBundle bundle(datagram);
-        if (!bundle.isValid())
+// Forgets about sources that have been quiet for longer than the transports
+// remember them (see qt_tuioSourceTimeout; with a second to spare for bundles
+// still on their way to us), releasing whatever they were still touching.
+void QTuioHandler::expireSources()
+{
+    const qint64 now = qt_tuioTimestamp();
+    bool expired = false;
+    QHash<quint64, Source>::Iterator it = m_sources.begin();
+    while (it != m_sources.end()) {
+        if (now - it->timestamp <= qt_tuioSourceTimeout + Q_INT64_C(1000000000)) {
+            ++it;
             continue;
+        }
 
-        // "A typical TUIO bundle will contain an initial ALIVE message,
-        // followed by an arbitrary number of SET messages that can fit into the
-        // actual bundle capacity and a concluding FSEQ message. A minimal TUIO
-        // bundle needs to contain at least the compulsory ALIVE and FSEQ
-        // messages. The FSEQ frame ID is incremented for each delivered bundle,
-        // while redundant bundles can be marked using the frame sequence ID
-        // -1."
-        QList<QOscMessage> messages = bundle.messages();
-
-        foreach (const QOscMessage &message, messages) {
-            if (message.addressPattern() != "/tuio/2Dcur") {
-                qWarning() << "Ignoring unknown address pattern " << message.addressPattern();
-                continue;
-            }
+        releaseSource(*it);
+        if (it->device != m_device)
+            m_spareDevices.append(it->device);
+        it = m_sources.erase(it);
+        expired = true;
+    }
 
-            QList<QVariant> arguments = message.arguments();
-            if (arguments.count() == 0) {
-                qWarning() << "Ignoring TUIO message with no arguments";
-                continue;
+    if (expired && m_snapshot)
+        publishSnapshot();
+}
+
+// Releases all of a source's touches, as if it had sent an empty frame.
+void QTuioHandler::releaseSource(Source &source)
+{
+    foreach (const QTuioCursor &tc, source.activeCursors) {
+        if (!tc.isHovering())
+            source.deadCursors.append(tc);
+    }
+    source.activeCursors.clear();
+    if (source.deadCursors.isEmpty())
+        return;
+
+    source.timestamp = qt_tuioTimestamp();
+    dispatchFrame(source);
+    source.deadCursors.clear();
+}
+
+void QTuioHandler::processBundle(quint64 sourceId, const QOscBundle &bundle, const QTuioPacketTimes &times)
+{
+    Source &source = this->source(sourceId);
+    source.timestamp = times.received;
+
+    if (m_trace) {
+        m_traceFrame = &m_trace->beginFrame(sourceId, times);
+        m_traceFrame->times[QTuioTrace::ProcessStart] = qt_tuioTimestamp();
+    }
+
+    // "A typical TUIO bundle will contain an initial ALIVE message,
+    // followed by an arbitrary number of SET messages that can fit into the
+    // actual bundle capacity and a concluding FSEQ message. A minimal TUIO
+    // bundle needs to contain at least the compulsory ALIVE and FSEQ
+    // messages. The FSEQ frame ID is incremented for each delivered bundle,
+    // while redundant bundles can be marked using the frame sequence ID
+    // -1."
+    QList<QOscMessage> messages = bundle.messages();
+
+    foreach (const QOscMessage &message, messages) {
+        const QByteArray addressPattern = message.addressPattern();
+        QTuioCursor::Profile profile;
+        if (addressPattern == "/tuio/2Dcur") {
+            profile = QTuioCursor::Cursor2D;
+        } else if (addressPattern == "/tuio/25Dcur") {
+            profile = QTuioCursor::Cursor25D;
+        } else if (addressPattern == "/tuio/3Dcur") {
+            profile = QTuioCursor::Cursor3D;
+        } else if (addressPattern == "/tuio/3Dobj") {
+            profile = QTuioCursor::Object3D;
+        } else {
+            // trackers send the profiles we don't know in every frame, once
+            // is enough to tell.
+            if (!m_unknownAddressPatterns.contains(addressPattern)) {
+                qWarning() << "Ignoring unknown address pattern " << addressPattern;
+                m_unknownAddressPatterns.insert(addressPattern);
             }
+            continue;
+        }
 
-            QByteArray messageType = arguments.at(0).toByteArray();
-            if (messageType == "source") {
-                process2DCurSource(message);
-            } else if (messageType == "alive") {
-                process2DCurAlive(message);
-            } else if (messageType == "set") {
-                process2DCurSet(message);
-            } else if (messageType == "fseq") {
-                process2DCurFseq(message);
-            } else {
-                qWarning() << "Ignoring unknown TUIO message type: " << messageType;
-                continue;
+        if (message.argumentCount() == 0) {
+            qWarning() << "Ignoring TUIO message with no arguments";
+            continue;
+        }
+
+        QByteArray messageType = message.stringAt(0);
+        if (messageType == "source") {
+            processSource(source, message);
+        } else if (messageType == "alive") {
+            processAlive(source, message, profile);
+            if (m_traceFrame)
+                m_traceFrame->times[QTuioTrace::AliveEnd] = qt_tuioTimestamp();
+        } else if (messageType == "set") {
+            processSet(source, message, profile);
+            if (m_traceFrame)
+                m_traceFrame->times[QTuioTrace::SetEnd] = qt_tuioTimestamp();
+        } else if (messageType == "fseq") {
+            if (m_traceFrame) {
+                m_traceFrame->frameId = message.argumentCount() > 1 && message.typeTagAt(1) == 'i' ? message.int32At(1) : -1;
+                m_traceFrame->cursors = source.activeCursors.size();
+                m_traceFrame->times[QTuioTrace::DispatchStart] = qt_tuioTimestamp();
             }
+            processFseq(source, message);
+        } else {
+            qWarning() << "Ignoring unknown TUIO message type: " << messageType;
+            continue;
         }
     }
+
+    m_traceFrame = 0;
 }
 
-void QTuioHandler::process2DCurSource(const QOscMessage &message)
+void QTuioHandler::processSource(Source &source, const QOscMessage &message)
 {
-    QList<QVariant> arguments = message.arguments();
-    if (arguments.count() != 2) {
-        qWarning() << "Ignoring malformed TUIO source message: " << arguments.count();
+    Q_UNUSED(source);
+
+    if (message.argumentCount() != 2) {
+        qWarning() << "Ignoring malformed TUIO source message: " << message.argumentCount();
         return;
     }
 
-    if (QMetaType::Type(arguments.at(1).type()) != QMetaType::QByteArray) {
+    if (message.typeTagAt(1) != 's') {
         qWarning() << "Ignoring malformed TUIO source message (bad argument type)";
         return;
     }
 
-    qCDebug(lcTuioSource) << "Got TUIO source message from: " << arguments.at(1).toByteArray();
+    qCDebug(lcTuioSource) << "Got TUIO source message from: " << message.stringAt(1);
 }
 
-void QTuioHandler::process2DCurAlive(const QOscMessage &message)
+void QTuioHandler::processAlive(Source &source, const QOscMessage &message, QTuioCursor::Profile profile)
 {
-    QList<QVariant> arguments = message.arguments();
-
     // delta the notified cursors that are active, against the ones we already
-    // know of.
+    // know of from the same profile. this is done in place, so that a frame
+    // with the same cursors as the last one doesn't allocate anything.
     //
     // TBD: right now we're assuming one 2Dcur alive message corresponds to a
     // new data source from the input. is this correct, or do we need to store
     // changes and only process the deltas on fseq?
-    QMap<int, QTuioCursor> oldActiveCursors = m_activeCursors;
-    QMap<int, QTuioCursor> newActiveCursors;
-
-    for (int i = 1; i < arguments.count(); ++i) {
-        if (QMetaType::Type(arguments.at(i).type()) != QMetaType::Int) {
-            qWarning() << "Ignoring malformed TUIO alive message (bad argument on position" << i << arguments << ")";
+    QVarLengthArray<int, 64> aliveIds;
+    for (int i = 1; i < message.argumentCount(); ++i) {
+        if (message.typeTagAt(i) != 'i') {
+            qWarning() << "Ignoring malformed TUIO alive message (bad argument on position" << i << message.arguments() << ")";
             return;
         }
 
-        int cursorId = arguments.at(i).toInt();
-        if (!oldActiveCursors.contains(cursorId)) {
-            // newly active
-            QTuioCursor cursor(cursorId);
-            cursor.setState(Qt::TouchPointPressed);
-            newActiveCursors.insert(cursorId, cursor);
-        } else {
-            // we already know about it, remove it so it isn't marked as released
-            QTuioCursor cursor = oldActiveCursors.value(cursorId);
-            cursor.setState(Qt::TouchPointStationary); // position change in SET will update if needed
-            newActiveCursors.insert(cursorId, cursor);
-            oldActiveCursors.remove(cursorId);
-        }
+        aliveIds.append(message.int32At(i));
     }
+    std::sort(aliveIds.begin(), aliveIds.end());
 
-    // anything left is dead now
-    QMap<int, QTuioCursor>::ConstIterator it = oldActiveCursors.constBegin();
-
-    // deadCursors should be cleared from the last FSEQ now
-    m_deadCursors.reserve(oldActiveCursors.size());
-
+    // anything we know of that isn't alive any more is dead now (but only
+    // needs releasing if it was touching)
+    //
     // TODO: there could be an issue of resource exhaustion here if FSEQ isn't
     // sent in a timely fashion. we should probably track message counts and
     // force-flush if we get too many built up.
-    while (it != oldActiveCursors.constEnd()) {
-        m_deadCursors.append(it.value());
-        ++it;
+    QMap<int, QTuioCursor>::Iterator it = source.activeCursors.begin();
+    while (it != source.activeCursors.end()) {
+        if (it->profile() != profile) {
+            ++it;
+        } else if (std::binary_search(aliveIds.constBegin(), aliveIds.constEnd(), it.key())) {
+            it->setState(Qt::TouchPointStationary); // position change in SET will update if needed
+            ++it;
+        } else {
+            if (!it->isHovering())
+                source.deadCursors.append(*it);
+            it = source.activeCursors.erase(it);
+        }
     }
 
-    m_activeCursors = newActiveCursors;
+    // and anything alive we don't know of yet is newly active
+    for (int i = 0; i < aliveIds.size(); ++i) {
+        if (!source.activeCursors.contains(aliveIds.at(i))) {
+            QTuioCursor cursor(aliveIds.at(i), profile);
+            cursor.setState(Qt::TouchPointPressed);
+            source.activeCursors.insert(aliveIds.at(i), cursor);
+        }
+    }
 }
 
-void QTuioHandler::process2DCurSet(const QOscMessage &message)
+void QTuioHandler::processSet(Source &source, const QOscMessage &message, QTuioCursor::Profile profile)
 {
-    QList<QVariant> arguments = message.arguments();
-    if (arguments.count() < 7) {
-        qWarning() << "Ignoring malformed TUIO set message with too few arguments: " << arguments.count();
+    static const char *const typeTags[] = {
+        "sifffff",           // 2Dcur: "set" s x y X Y m
+        "sifffffff",         // 25Dcur: "set" s x y z X Y Z m
+        "sifffffff",         // 3Dcur: "set" s x y z X Y Z m
+        "siiffffffffffffff"  // 3Dobj: "set" s i x y z a b c X Y Z A B C m r
+    };
+    const char *expectedTypeTags = typeTags[profile];
+
+    if (message.argumentCount() < int(qstrlen(expectedTypeTags))) {
+        qWarning() << "Ignoring malformed TUIO set message with too few arguments: " << message.argumentCount();
         return;
     }
 
-    if (QMetaType::Type(arguments.at(1).type()) != QMetaType::Int   ||
-        QMetaType::Type(arguments.at(2).type()) != QMetaType::Float ||
-        QMetaType::Type(arguments.at(3).type()) != QMetaType::Float ||
-        QMetaType::Type(arguments.at(4).type()) != QMetaType::Float ||
-        QMetaType::Type(arguments.at(5).type()) != QMetaType::Float ||
-        QMetaType::Type(arguments.at(6).type()) != QMetaType::Float
-       ) {
-        qWarning() << "Ignoring malformed TUIO set message with bad types: " << arguments;
+    if (!message.typeTags().startsWith(expectedTypeTags)) {
+        qWarning() << "Ignoring malformed TUIO set message with bad types: " << message.arguments();
         return;
     }
 
-    int cursorId = arguments.at(1).toInt();
-    float x = arguments.at(2).toFloat();
-    float y = arguments.at(3).toFloat();
-    float vx = arguments.at(4).toFloat();
-    float vy = arguments.at(5).toFloat();
-    float acceleration = arguments.at(6).toFloat();
-
-    QMap<int, QTuioCursor>::Iterator it = m_activeCursors.find(cursorId);
-    if (it == m_activeCursors.end()) {
+    int cursorId = message.int32At(1);
+    QMap<int, QTuioCursor>::Iterator it = source.activeCursors.find(cursorId);
+    if (it == source.activeCursors.end()) {
         qWarning() << "Ignoring malformed TUIO set for nonexistent cursor " << cursorId;
         return;
     }
 
-    qCDebug(lcTuioSet) << "Processing SET for " << cursorId << " x: " << x << y << vx << vy << acceleration;
     QTuioCursor &cur = *it;
-    cur.setX(x);
-    cur.setY(y);
-    cur.setVX(vx);
-    cur.setVY(vy);
-    cur.setAcceleration(acceleration);
+    switch (profile) {
+    case QTuioCursor::Cursor2D:
+        cur.setX(message.floatAt(2));
+        cur.setY(message.floatAt(3));
+        cur.setVX(message.floatAt(4));
+        cur.setVY(message.floatAt(5));
+        cur.setAcceleration(message.floatAt(6));
+        break;
+    case QTuioCursor::Cursor25D:
+    case QTuioCursor::Cursor3D:
+        cur.setX(message.floatAt(2));
+        cur.setY(message.floatAt(3));
+        cur.setZ(message.floatAt(4));
+        cur.setVX(message.floatAt(5));
+        cur.setVY(message.floatAt(6));
+        cur.setVZ(message.floatAt(7));
+        cur.setAcceleration(message.floatAt(8));
+        break;
+    case QTuioCursor::Object3D:
+        // the class ID, angles and rotation speeds aren't of any use for
+        // touches
+        cur.setX(message.floatAt(3));
+        cur.setY(message.floatAt(4));
+        cur.setZ(message.floatAt(5));
+        cur.setVX(message.floatAt(9));
+        cur.setVY(message.floatAt(10));
+        cur.setVZ(message.floatAt(11));
+        cur.setAcceleration(message.floatAt(15));
+        break;
+    }
+
+    qCDebug(lcTuioSet) << "Processing SET for " << cursorId << " x: " << cur.x() << cur.y() << cur.z()
+                       << cur.vx() << cur.vy() << cur.vz() << cur.acceleration();
+}
+
+// The velocity (in normalized units per second) to deliver for a cursor: the
+// tracker's, or with the kinematics option, the one derived from where the
+// cursor has been (see qt_tuioUpdateMotion). Many trackers send zero, or
+// velocities that are too noisy to fling with.
+QPointF QTuioHandler::cursorVelocity(const QTuioCursor &tc) const
+{
+    if (m_kinematics == DerivedKinematics ||
+        (m_kinematics == DerivedIfMissing && tc.vx() == 0 && tc.vy() == 0)) {
+        return QPointF(tc.motionState().vx, tc.motionState().vy);
+    }
+    return QPointF(tc.vx(), tc.vy());
 }
 
-QWindowSystemInterface::TouchPoint QTuioHandler::cursorToTouchPoint(const QTuioCursor &tc, QWindow *win)
+// Likewise for the acceleration.
+float QTuioHandler::cursorAcceleration(const QTuioCursor &tc) const
+{
+    if (m_kinematics == DerivedKinematics ||
+        (m_kinematics == DerivedIfMissing && tc.acceleration() == 0)) {
+        return tc.motionState().acceleration;
+    }
+    return tc.acceleration();
+}
+
+// Maps a cursor to a touch point, with the (already mapped, see mapCursors)
+// normalized position scaled into target (in global coordinates).
+QWindowSystemInterface::TouchPoint QTuioHandler::cursorToTouchPoint(const QTuioCursor &tc, const QPointF &normalPosition, const QRectF &target)
 {
     QWindowSystemInterface::TouchPoint tp;
     tp.id = tc.id();
-    tp.pressure = 1.0f;
-
-    tp.normalPosition = QPointF(tc.x(), tc.y());
+    tp.pressure = m_hoverHeight > 0 ? qBound(qreal(0), 1 - tc.z() / m_hoverHeight, qreal(1)) : 1.0;
 
-    if (!m_transform.isIdentity())
-        tp.normalPosition = m_transform.map(tp.normalPosition);
+    tp.normalPosition = normalPosition;
 
     tp.state = tc.state();
     tp.area = QRectF(0, 0, 1, 1);
 
-    // we map the touch to the size of the window. we do this, because frankly,
-    // trying to figure out which part of the screen to hit in order to press an
-    // element on the UI is pretty tricky when one is not using an overlay-style
-    // TUIO device.
-    //
-    // in the future, it might make sense to make this choice optional,
-    // dependent on the spec.
-    QPointF relPos = QPointF(win->size().width() * tp.normalPosition.x(), win->size().height() * tp.normalPosition.y());
-    QPointF delta = relPos - relPos.toPoint();
-    tp.area.moveCenter(win->mapToGlobal(relPos.toPoint()) + delta);
-    tp.velocity = QVector2D(win->size().width() * tc.vx(), win->size().height() * tc.vy());
+    QPointF relPos = QPointF(target.width() * tp.normalPosition.x(), target.height() * tp.normalPosition.y());
+    tp.area.moveCenter(target.topLeft() + relPos);
+    const QPointF velocity = cursorVelocity(tc);
+    tp.velocity = QVector2D(target.width() * velocity.x(), target.height() * velocity.y());
     return tp;
 }
 
+// Maps normalized positions in place, as configured: rotated and inverted, or
+// through the calibration matrix, then corrected with the calibration mesh.
+void QTuioHandler::mapPoints(QPointF *points, int count) const
+{
+    m_mapFunction(m_transform, points, count);
+    if (!m_calibrationMesh.isNull())
+        m_calibrationMesh.map(points, count);
+}
 
-void QTuioHandler::process2DCurFseq(const QOscMessage &message)
+// Collects the normalized positions of all cursors in the frame, active ones
+// first, then dead ones, in the order they are iterated in, and maps them all
+// in one go.
+void QTuioHandler::mapCursors(const Source &source)
+{
+    m_positions.resize(source.activeCursors.size() + source.deadCursors.size());
+
+    QPointF *position = m_positions.data();
+    QMap<int, QTuioCursor>::ConstIterator it = source.activeCursors.constBegin();
+    for (; it != source.activeCursors.constEnd(); ++it) {
+        if (!it->isHovering())
+            *position++ = QPointF(it->x(), it->y());
+    }
+    for (int i = 0; i < source.deadCursors.size(); ++i)
+        *position++ = QPointF(source.deadCursors.at(i).x(), source.deadCursors.at(i).y());
+
+    m_positions.resize(position - m_positions.constData());
+    mapPoints(m_positions.data(), m_positions.size());
+}
+
+void QTuioHandler::processFseq(Source &source, const QOscMessage &message)
 {
     Q_UNUSED(message); // TODO: do we need to do anything with the frame id?
 
+    // smooth the whole frame before anything looks at the positions, also
+    // cursors that didn't get a SET this frame, so they settle.
+    if (m_smoothing) {
+        QMap<int, QTuioCursor>::Iterator it = source.activeCursors.begin();
+        for (; it != source.activeCursors.end(); ++it)
+            m_smoothingFilter.filter(*it, source.timestamp);
+    }
+
+    // the velocities follow the smoothed positions, like the touch points
+    if (m_kinematics != SenderKinematics) {
+        QMap<int, QTuioCursor>::Iterator it = source.activeCursors.begin();
+        for (; it != source.activeCursors.end(); ++it)
+            qt_tuioUpdateMotion(*it, source.timestamp);
+    }
+
+    if (m_hoverHeight > 0)
+        updateHovering(source);
+
+    dispatchFrame(source);
+
+    QMap<int, QTuioCursor>::Iterator it = source.activeCursors.begin();
+    for (; it != source.activeCursors.end(); ++it)
+        it->setDelivered();
+
+    source.deadCursors.clear();
+
+    if (m_snapshot && source.tile.isNull())
+        publishSnapshot();
+}
+
+// Hands the frame on: into the stitched surface, or to the window(s) touched
+// (and whoever we forward to).
+void QTuioHandler::dispatchFrame(Source &source)
+{
+    if (!source.tile.isNull()) {
+        stitchFrame(source);
+        return;
+    }
+
+    if (m_windowIndex)
+        dispatchToWindows(source);
+    else
+        dispatchToFocusWindow(source);
+
+    if (!m_forwarder.isEmpty())
+        forwardFrame(source);
+}
+
+// With the hover option, cursors higher above the surface than m_hoverHeight
+// (as the 2.5D and 3D profiles tell) hover rather than touch. They are left
+// out of everything delivered, so hands moving above the surface cost the
+// application nothing; one coming down is pressed, one lifting off released.
+// Closer to the surface than that, the height makes for the pressure: 1 on
+// the surface, down to 0 at m_hoverHeight.
+void QTuioHandler::updateHovering(Source &source)
+{
+    QMap<int, QTuioCursor>::Iterator it = source.activeCursors.begin();
+    for (; it != source.activeCursors.end(); ++it) {
+        QTuioCursor &tc = *it;
+        const bool hovering = tc.z() > m_hoverHeight;
+
+        if (hovering && !tc.isHovering()) {
+            // (one that was never delivered has nothing to release)
+            if (tc.state() != Qt::TouchPointPressed)
+                source.deadCursors.append(tc);
+            tc.setHovering(true);
+        } else if (!hovering && tc.isHovering()) {
+            tc.setHovering(false);
+            tc.setState(Qt::TouchPointPressed);
+            tc.setMoving(false);
+        } else if (!hovering && tc.state() == Qt::TouchPointStationary &&
+                   !qFuzzyCompare(tc.z() + 2.0, tc.deliveredZ() + 2.0)) {
+            // pressing harder (or less hard) without moving
+            tc.setState(Qt::TouchPointMoved);
+        }
+    }
+}
+
+// Video walls are built from several trackers, each covering a tile of the
+// surface, each with cursor IDs of its own. Their frames are merged into
+// m_stitched, a source covering the whole surface, with IDs handed out by
+// m_stitchedIds, and delivered together in one event per window: once
+// whatever arrived in the same pass of the event loop has been processed.
+//
+// A finger crossing from one tile into the next is released by one tracker
+// and pressed by the other. To keep it one touch, a cursor released within
+// m_seamDistance of an edge shared with another tile is held (and not
+// released) for up to m_seamTimeout milliseconds. If a cursor is pressed
+// within m_seamDistance of it in the meantime, that one carries on as the
+// same touch.
+void QTuioHandler::stitchFrame(Source &source)
+{
+    const QRectF &tile = source.tile;
+
+    foreach (const QTuioCursor &tc, source.activeCursors) {
+        if (tc.isHovering())
+            continue;
+
+        const qreal x = tile.x() + tc.x() * tile.width();
+        const qreal y = tile.y() + tc.y() * tile.height();
+
+        QHash<int, int>::ConstIterator idIt = source.stitchedIds.constFind(tc.id());
+        int stitchedId;
+        if (idIt != source.stitchedIds.constEnd()) {
+            stitchedId = *idIt;
+        } else {
+            // continuing one that just left another tile?
+            stitchedId = -1;
+            qreal closest = m_seamDistance * m_seamDistance;
+            QHash<int, qint64>::ConstIterator it = m_seamCursors.constBegin();
+            for (; it != m_seamCursors.constEnd(); ++it) {
+                const QTuioCursor &held = m_stitched.activeCursors[it.key()];
+                const qreal dx = held.x() - x;
+                const qreal dy = held.y() - y;
+                if (dx * dx + dy * dy <= closest) {
+                    closest = dx * dx + dy * dy;
+                    stitchedId = it.key();
+                }
+            }
+
+            if (stitchedId >= 0) {
+                m_seamCursors.remove(stitchedId);
+            } else {
+                stitchedId = m_stitchedIds.allocate();
+                QTuioCursor cursor(stitchedId);
+                cursor.setX(x);
+                cursor.setY(y);
+                m_stitched.activeCursors.insert(stitchedId, cursor);
+            }
+            source.stitchedIds.insert(tc.id(), stitchedId);
+        }
+
+        QTuioCursor &cursor = m_stitched.activeCursors[stitchedId];
+        cursor.setX(x);
+        cursor.setY(y);
+        cursor.setVX(tc.vx() * tile.width());
+        cursor.setVY(tc.vy() * tile.height());
+        cursor.setAcceleration(tc.acceleration());
+    }
+
+    const qint64 now = qt_tuioTimestamp();
+    foreach (const QTuioCursor &tc, source.deadCursors) {
+        QHash<int, int>::Iterator idIt = source.stitchedIds.find(tc.id());
+        if (idIt == source.stitchedIds.end())
+            continue;
+        const int stitchedId = *idIt;
+        source.stitchedIds.erase(idIt);
+        const QTuioCursor &cursor = m_stitched.activeCursors[stitchedId];
+
+        // near an edge that isn't the edge of the whole surface?
+        const bool nearSeam = (cursor.x() - tile.left() < m_seamDistance && tile.left() > 0) ||
+                              (tile.right() - cursor.x() < m_seamDistance && tile.right() < 1) ||
+                              (cursor.y() - tile.top() < m_seamDistance && tile.top() > 0) ||
+                              (tile.bottom() - cursor.y() < m_seamDistance && tile.bottom() < 1);
+        if (nearSeam && m_seamTimeout > 0)
+            m_seamCursors.insert(stitchedId, now + m_seamTimeout * Q_INT64_C(1000000));
+        else
+            releaseStitchedCursor(stitchedId);
+    }
+
+    m_stitched.timestamp = source.timestamp;
+    if (!m_stitchTimer->isActive() || m_stitchTimer->interval() > 0)
+        m_stitchTimer->start(0);
+}
+
+void QTuioHandler::releaseStitchedCursor(int stitchedId)
+{
+    m_stitched.deadCursors.append(m_stitched.activeCursors.take(stitchedId));
+}
+
+void QTuioHandler::flushStitchedFrame()
+{
+    // give up on held cursors nobody continued
+    const qint64 now = qt_tuioTimestamp();
+    qint64 nextDeadline = 0;
+    QHash<int, qint64>::Iterator it = m_seamCursors.begin();
+    while (it != m_seamCursors.end()) {
+        if (*it <= now) {
+            releaseStitchedCursor(it.key());
+            it = m_seamCursors.erase(it);
+        } else {
+            if (!nextDeadline || *it < nextDeadline)
+                nextDeadline = *it;
+            ++it;
+        }
+    }
+
+    // the stitched cursors get their own, in stitched coordinates; those of
+    // the tiles would jump when a cursor crosses a seam
+    if (m_kinematics != SenderKinematics) {
+        QMap<int, QTuioCursor>::Iterator it = m_stitched.activeCursors.begin();
+        for (; it != m_stitched.activeCursors.end(); ++it)
+            qt_tuioUpdateMotion(*it, m_stitched.timestamp);
+    }
+
+    if (m_windowIndex)
+        dispatchToWindows(m_stitched);
+    else
+        dispatchToFocusWindow(m_stitched);
+
+    if (!m_forwarder.isEmpty())
+        forwardFrame(m_stitched);
+
+    QMap<int, QTuioCursor>::Iterator cursorIt = m_stitched.activeCursors.begin();
+    for (; cursorIt != m_stitched.activeCursors.end(); ++cursorIt) {
+        cursorIt->setDelivered();
+        cursorIt->setState(Qt::TouchPointStationary);
+    }
+
+    for (int i = 0; i < m_stitched.deadCursors.size(); ++i)
+        m_stitchedIds.release(m_stitched.deadCursors.at(i).id());
+    m_stitched.deadCursors.clear();
+
+    if (nextDeadline)
+        m_stitchTimer->start(int((nextDeadline - now) / 1000000) + 1);
+
+    if (m_snapshot)
+        publishSnapshot();
+}
+
+// Publishes the touches of all trackers as they are now (see the snapshot
+// option), the way they were last delivered, for applications that poll
+// rather than handle touch events.
+void QTuioHandler::publishSnapshot()
+{
+    QTuioSnapshot &snapshot = m_snapshot->beginWrite();
+    snapshot.count = 0;
+    qint64 timestamp = 0;
+
+    QHash<quint64, Source>::ConstIterator it = m_sources.constBegin();
+    for (;; ++it) {
+        // all sources, but those stitched together, then the stitched surface
+        const bool stitched = it == m_sources.constEnd();
+        const Source &source = stitched ? m_stitched : *it;
+        if (!source.tile.isNull())
+            continue;
+
+        timestamp = qMax(timestamp, source.timestamp);
+        foreach (const QTuioCursor &tc, source.activeCursors) {
+            if (snapshot.count == QTuioSnapshot::Capacity)
+                break;
+            if (tc.isHovering())
+                continue;
+
+            // position, and position moved by the velocity, as in forwardFrame
+            const QPointF position(tc.x(), tc.y());
+            QPointF points[2] = { position, position + cursorVelocity(tc) };
+            mapPoints(points, 2);
+
+            QTuioSnapshotPoint &point = snapshot.points[snapshot.count++];
+            point.id = tc.id();
+            point.source = source.index;
+            point.x = points[0].x();
+            point.y = points[0].y();
+            point.vx = points[1].x() - points[0].x();
+            point.vy = points[1].y() - points[0].y();
+        }
+
+        if (stitched)
+            break;
+    }
+
+    snapshot.timestamp = qt_tuioClock().msecsSinceReference() + timestamp / 1000000;
+    m_snapshot->endWrite();
+}
+
+// Sends what was just delivered on (see forwardmapped=) as TUIO 2Dcur again:
+// smoothed, thresholded and mapped like the touch points, so that another
+// application sees the same touches. To the receiver, that's one tracker, so
+// every frame covers the touches of all sources (tiles as the stitched
+// surface), whichever one was dispatched, with IDs of our own, handed out by
+// m_forwardedIds. Stitched cursors not yet delivered wait for their flush.
+void QTuioHandler::forwardFrame(Source &dispatched)
+{
+    m_forwardedCursors.clear();
+    QHash<quint64, Source>::Iterator it = m_sources.begin();
+    for (;; ++it) {
+        const bool stitched = it == m_sources.end();
+        Source &source = stitched ? m_stitched : *it;
+        if (!source.tile.isNull())
+            continue;
+
+        const bool pending = stitched && &dispatched != &m_stitched;
+        QMap<int, QTuioCursor>::ConstIterator cursorIt = source.activeCursors.constBegin();
+        for (; cursorIt != source.activeCursors.constEnd(); ++cursorIt) {
+            if (cursorIt->isHovering() || (pending && cursorIt->state() == Qt::TouchPointPressed))
+                continue;
+
+            QHash<int, int>::Iterator idIt = source.forwardedIds.find(cursorIt->id());
+            if (idIt == source.forwardedIds.end())
+                idIt = source.forwardedIds.insert(cursorIt->id(), m_forwardedIds.allocate());
+            m_forwardedCursors.append(qMakePair(&*cursorIt, *idIt));
+        }
+
+        if (stitched)
+            break;
+    }
+
+    // the released ones are gone from the ALIVE message, their IDs free again
+    foreach (const QTuioCursor &tc, dispatched.deadCursors) {
+        QHash<int, int>::Iterator idIt = dispatched.forwardedIds.find(tc.id());
+        if (idIt != dispatched.forwardedIds.end()) {
+            m_forwardedIds.release(*idIt);
+            dispatched.forwardedIds.erase(idIt);
+        }
+    }
+
+    // positions, then positions moved by the velocities, so the velocities
+    // get rotated and scaled just the same
+    const int count = m_forwardedCursors.size();
+    m_positions.resize(count * 2);
+    for (int i = 0; i < count; ++i) {
+        const QTuioCursor &tc = *m_forwardedCursors.at(i).first;
+        m_positions[i] = QPointF(tc.x(), tc.y());
+        m_positions[count + i] = m_positions.at(i) + cursorVelocity(tc);
+    }
+    mapPoints(m_positions.data(), m_positions.size());
+
+    m_writer.clear();
+    m_writer.beginBundle();
+
+    QVarLengthArray<char, 64> aliveTags;
+    aliveTags.append('s');
+    for (int i = 0; i < count; ++i)
+        aliveTags.append('i');
+    aliveTags.append('\0');
+
+    m_writer.beginMessage("/tuio/2Dcur", aliveTags.constData());
+    m_writer.addString("alive");
+    for (int i = 0; i < count; ++i)
+        m_writer.addInt32(m_forwardedCursors.at(i).second);
+    m_writer.endMessage();
+
+    for (int i = 0; i < count; ++i) {
+        const QPointF velocity = m_positions.at(count + i) - m_positions.at(i);
+        m_writer.beginMessage("/tuio/2Dcur", "sifffff");
+        m_writer.addString("set");
+        m_writer.addInt32(m_forwardedCursors.at(i).second);
+        m_writer.addFloat(m_positions.at(i).x());
+        m_writer.addFloat(m_positions.at(i).y());
+        m_writer.addFloat(velocity.x());
+        m_writer.addFloat(velocity.y());
+        m_writer.addFloat(cursorAcceleration(*m_forwardedCursors.at(i).first));
+        m_writer.endMessage();
+    }
+
+    m_writer.beginMessage("/tuio/2Dcur", "si");
+    m_writer.addString("fseq");
+    m_writer.addInt32(qint32(++m_forwardedFrame));
+    m_writer.endMessage();
+
+    m_writer.endBundle();
+    m_forwarder.forward(m_writer.data().constData(), m_writer.data().size());
+}
+
+// Trackers never hold perfectly still, so without this a finger resting on the
+// table turns into a steady stream of tiny moves. A cursor at rest only starts
+// moving once it gets further than the threshold away from where it was last
+// delivered. After that, it keeps moving as long as it moves more than a
+// quarter of the threshold every frame (so slow, deliberate movement isn't
+// chopped up), and comes to rest again otherwise.
+//
+// Sub-threshold changes are dropped entirely, the cursor stays where it was
+// last delivered.
+void QTuioHandler::filterMovement(Source &source, const QSizeF &targetSize)
+{
+    if (m_movementThreshold <= 0)
+        return;
+
+    const qreal scaleX = m_movementThresholdInPixels ? targetSize.width() : 1.0;
+    const qreal scaleY = m_movementThresholdInPixels ? targetSize.height() : 1.0;
+
+    QMap<int, QTuioCursor>::Iterator it = source.activeCursors.begin();
+    for (; it != source.activeCursors.end(); ++it) {
+        QTuioCursor &tc = *it;
+        if (tc.state() == Qt::TouchPointStationary)
+            tc.setMoving(false);
+        if (tc.state() != Qt::TouchPointMoved)
+            continue;
+
+        // measure in the same space the position is delivered in, rotation
+        // swaps the axes.
+        QPointF points[2] = { QPointF(tc.deliveredX(), tc.deliveredY()), QPointF(tc.x(), tc.y()) };
+        mapPoints(points, 2);
+        const qreal dx = (points[1].x() - points[0].x()) * scaleX;
+        const qreal dy = (points[1].y() - points[0].y()) * scaleY;
+        const qreal threshold = tc.isMoving() ? m_movementThreshold / 4 : m_movementThreshold;
+
+        if (dx * dx + dy * dy > threshold * threshold) {
+            tc.setMoving(true);
+        } else {
+            tc.setX(tc.deliveredX());
+            tc.setY(tc.deliveredY());
+            tc.setState(Qt::TouchPointStationary);
+            tc.setMoving(false);
+        }
+    }
+}
+
+void QTuioHandler::dispatchToFocusWindow(Source &source)
+{
     QWindow *win = QGuiApplication::focusWindow();
     if (!win)
         return;
 
+    filterMovement(source, win->size());
+    mapCursors(source);
+
+    // we map the touch to the size of the window. we do this, because frankly,
+    // trying to figure out which part of the screen to hit in order to press an
+    // element on the UI is pretty tricky when one is not using an overlay-style
+    // TUIO device.
+    //
+    // if that isn't what you want, use the screen option, which maps to the
+    // screen instead, and hit-tests each touch (see dispatchToWindows).
+    QRectF target(win->mapToGlobal(QPoint(0, 0)), win->size());
     QList<QWindowSystemInterface::TouchPoint> tpl;
+    tpl.reserve(source.activeCursors.size() + source.deadCursors.size());
+    bool changed = !source.deadCursors.isEmpty();
+    const QPointF *position = m_positions.constData();
 
-    foreach (const QTuioCursor &tc, m_activeCursors) {
-        QWindowSystemInterface::TouchPoint tp = cursorToTouchPoint(tc, win);
+    foreach (const QTuioCursor &tc, source.activeCursors) {
+        if (tc.isHovering())
+            continue;
+        QWindowSystemInterface::TouchPoint tp = cursorToTouchPoint(tc, *position++, target);
         tpl.append(tp);
+        changed |= tc.state() != Qt::TouchPointStationary;
     }
 
-    foreach (const QTuioCursor &tc, m_deadCursors) {
-        QWindowSystemInterface::TouchPoint tp = cursorToTouchPoint(tc, win);
+    foreach (const QTuioCursor &tc, source.deadCursors) {
+        QWindowSystemInterface::TouchPoint tp = cursorToTouchPoint(tc, *position++, target);
         tp.state = Qt::TouchPointReleased;
         tpl.append(tp);
     }
-    QWindowSystemInterface::handleTouchEvent(win, m_device, tpl);
 
-    m_deadCursors.clear();
+    // nothing pressed, moved or released: don't bother the application.
+    if (!changed)
+        return;
+
+    deliverTouchEvent(win, source.device, tpl, source.timestamp);
+}
+
+struct QTuioWindowEvent
+{
+    QWindow *window;
+    bool changed;
+    QList<QWindowSystemInterface::TouchPoint> points;
+};
+
+typedef QVarLengthArray<QTuioWindowEvent, 4> QTuioWindowEvents;
+
+static void qt_appendTouchPoint(QTuioWindowEvents &events, QWindow *win, const QWindowSystemInterface::TouchPoint &tp)
+{
+    int i = 0;
+    while (i < events.size() && events.at(i).window != win)
+        ++i;
+
+    if (i == events.size()) {
+        QTuioWindowEvent event;
+        event.window = win;
+        event.changed = false;
+        events.append(event);
+    }
+
+    events[i].changed |= tp.state != Qt::TouchPointStationary;
+    events[i].points.append(tp);
+}
+
+// Maps the touches onto the configured screen, and sends each to the top-level
+// window it was pressed in, like a touchscreen would. Touches that weren't
+// pressed on one of our windows are dropped.
+void QTuioHandler::dispatchToWindows(Source &source)
+{
+    const QRectF target = m_windowIndex->targetGeometry();
+    QTuioWindowEvents events;
+
+    filterMovement(source, target.size());
+    mapCursors(source);
+    const QPointF *position = m_positions.constData();
+
+    foreach (const QTuioCursor &tc, source.activeCursors) {
+        if (tc.isHovering())
+            continue;
+        QWindowSystemInterface::TouchPoint tp = cursorToTouchPoint(tc, *position++, target);
+
+        QWindow *win;
+        if (tc.state() == Qt::TouchPointPressed) {
+            win = m_windowIndex->windowAt(tp.area.center().toPoint());
+            source.windows.insert(tc.id(), win);
+        } else {
+            win = source.windows.value(tc.id()).data();
+        }
+
+        if (win)
+            qt_appendTouchPoint(events, win, tp);
+    }
+
+    foreach (const QTuioCursor &tc, source.deadCursors) {
+        QWindowSystemInterface::TouchPoint tp = cursorToTouchPoint(tc, *position++, target);
+        tp.state = Qt::TouchPointReleased;
+
+        QWindow *win = source.windows.take(tc.id()).data();
+        if (win)
+            qt_appendTouchPoint(events, win, tp);
+    }
+
+    for (int i = 0; i < events.size(); ++i) {
+        if (events.at(i).changed)
+            deliverTouchEvent(events.at(i).window, source.device, events.at(i).points, source.timestamp);
+    }
+}
+
+// Merges points into a frame that hasn't been delivered yet, keeping the
+// latest position of every point, and any press or release. Returns false if
+// that can't be done without losing a press or release.
+static bool qt_mergeTouchPoints(QList<QWindowSystemInterface::TouchPoint> &pending,
+                                const QList<QWindowSystemInterface::TouchPoint> &points)
+{
+    QVarLengthArray<int, 32> indices;
+    indices.resize(points.size());
+
+    for (int i = 0; i < points.size(); ++i) {
+        int j = 0;
+        while (j < pending.size() && pending.at(j).id != points.at(i).id)
+            ++j;
+        indices[i] = j < pending.size() ? j : -1;
+
+        if (indices[i] < 0)
+            continue;
+
+        const Qt::TouchPointState oldState = pending.at(j).state;
+        const Qt::TouchPointState newState = points.at(i).state;
+        if ((oldState == Qt::TouchPointPressed && newState == Qt::TouchPointReleased) ||
+            (oldState == Qt::TouchPointReleased && newState != Qt::TouchPointReleased))
+            return false;
+    }
+
+    for (int i = 0; i < points.size(); ++i) {
+        if (indices[i] < 0) {
+            pending.append(points.at(i));
+            continue;
+        }
+
+        QWindowSystemInterface::TouchPoint &tp = pending[indices[i]];
+        const Qt::TouchPointState oldState = tp.state;
+        tp = points.at(i);
+        if (oldState == Qt::TouchPointPressed ||
+            (oldState == Qt::TouchPointMoved && tp.state == Qt::TouchPointStationary))
+            tp.state = oldState;
+    }
+
+    return true;
+}
+
+// When the GUI thread stalls, the window system event queue (and behind it,
+// the socket) fills up with frames nobody is interested in any more: once it
+// catches up, the application would replay all that old motion. So with the
+// backpressure option, while more than m_backpressureThreshold window system
+// events (of any kind, Qt doesn't tell which) are outstanding, frames
+// are held back, and merged: only the latest position of every touch point
+// survives, along with every press and release. When the queue has drained,
+// what was held back is delivered as one catch-up frame (more, only if a
+// touch point was pressed and released again in the meantime).
+//
+// With the immediate option, every frame is held back like that, until
+// whatever arrived in the same pass of the event loop has been processed (see
+// flushImmediateFrames).
+void QTuioHandler::deliverTouchEvent(QWindow *win, QTouchDevice *device, const QList<QWindowSystemInterface::TouchPoint> &points, qint64 timestamp)
+{
+    if (m_backpressureThreshold <= 0 && !m_immediate) {
+        sendTouchEvent(win, device, points, timestamp);
+        return;
+    }
+
+    const int queued = QWindowSystemInterface::windowSystemEventsQueued();
+    m_stats.queueDepth.store(queued);
+    if (queued > m_stats.maxQueueDepth.load())
+        m_stats.maxQueueDepth.store(queued);
+
+    PendingFrame *pending = 0;
+    for (int i = 0; i < m_pendingFrames.size() && !pending; ++i) {
+        if (m_pendingFrames.at(i).window == win && m_pendingFrames.at(i).device == device)
+            pending = &m_pendingFrames[i];
+    }
+
+    if (!pending && !m_immediate && queued <= m_backpressureThreshold) {
+        sendTouchEvent(win, device, points, timestamp);
+        return;
+    }
+
+    if (!pending) {
+        PendingFrame frame;
+        frame.window = win;
+        frame.device = device;
+        frame.timestamp = timestamp;
+        frame.points = points;
+        m_pendingFrames.append(frame);
+    } else if (qt_mergeTouchPoints(pending->points, points)) {
+        pending->timestamp = timestamp;
+        qt_tuioCount(m_stats.droppedFrames);
+    } else {
+        pending->edges.append(pending->points);
+        pending->timestamp = timestamp;
+        pending->points = points;
+    }
+
+    if (m_traceFrame)
+        (pending ? pending : &m_pendingFrames.last())->traceFrames.append(m_traceFrame->number);
+
+    if (m_backpressureThreshold > 0 && queued > m_backpressureThreshold) {
+        if (!m_backpressureTimer->isActive())
+            m_backpressureTimer->start();
+        return;
+    }
+
+    if (m_immediate) {
+        if (!m_immediateTimer->isActive())
+            m_immediateTimer->start(0);
+        return;
+    }
+
+    flushPendingFrames();
+}
+
+void QTuioHandler::flushPendingFrames()
+{
+    if (m_backpressureThreshold > 0 && QWindowSystemInterface::windowSystemEventsQueued() > m_backpressureThreshold) {
+        // still behind, try again later
+        if (!m_backpressureTimer->isActive())
+            m_backpressureTimer->start();
+        return;
+    }
+
+    m_backpressureTimer->stop();
+
+    for (int i = 0; i < m_pendingFrames.size(); ++i) {
+        const PendingFrame &frame = m_pendingFrames.at(i);
+        if (!frame.window)
+            continue;
+
+        for (int j = 0; j < frame.edges.size(); ++j)
+            sendTouchEvent(frame.window.data(), frame.device, frame.edges.at(j), frame.timestamp);
+        sendTouchEvent(frame.window.data(), frame.device, frame.points, frame.timestamp);
+
+        if (m_trace) {
+            const qint64 delivered = qt_tuioTimestamp();
+            for (int j = 0; j < frame.traceFrames.size(); ++j) {
+                if (QTuioTrace::Frame *traced = m_trace->frame(frame.traceFrames.at(j)))
+                    traced->times[QTuioTrace::Delivered] = delivered;
+            }
+        }
+    }
+
+    m_pendingFrames.clear();
+
+    if (m_immediate)
+        flushImmediateFrames();
+}
+
+// Delivers what deliverTouchEvent held back with the immediate option: the
+// touch events are handed to Qt, and then straight on to the application,
+// instead of waiting for the event loop to come around to the window system
+// event queue again. Several frames arriving together only cost the
+// application one event.
+void QTuioHandler::flushImmediateFrames()
+{
+    m_immediateTimer->stop();
+
+    if (!m_pendingFrames.isEmpty()) {
+        flushPendingFrames(); // comes back here
+        return;
+    }
+
+    if (m_deliveredTimestamps.isEmpty())
+        return;
+
+    QWindowSystemInterface::flushWindowSystemEvents();
+
+    const qint64 now = qt_tuioTimestamp();
+    for (int i = 0; i < m_deliveredTimestamps.size(); ++i)
+        qt_tuioRecordLatency(m_stats.deliveryLatency, m_stats.averageDeliveryLatency, m_stats.maxDeliveryLatency,
+                             now - m_deliveredTimestamps.at(i));
+    m_deliveredTimestamps.clear();
+}
+
+// Hands a touch event to Qt, stamped with the time its datagram arrived
+// rather than the time the GUI thread gets around to it, so velocities
+// computed from it aren't thrown off by how busy we (or the GUI thread) are.
+void QTuioHandler::sendTouchEvent(QWindow *win, QTouchDevice *device, const QList<QWindowSystemInterface::TouchPoint> &points, qint64 timestamp)
+{
+    const qint64 latency = qMax(Q_INT64_C(0), qt_tuioTimestamp() - timestamp);
+
+    // Qt's event timestamps are milliseconds on a clock of its own.
+    const qint64 eventTime = QWindowSystemInterfacePrivate::eventTime.elapsed() - latency / 1000000;
+    QWindowSystemInterface::handleTouchEvent(win, ulong(qMax(Q_INT64_C(0), eventTime)), device, points);
+
+    // (frames held back and delivered later, from flushPendingFrames, don't
+    // belong to the frame being traced; it records them itself)
+    if (m_traceFrame)
+        m_traceFrame->times[QTuioTrace::Delivered] = qt_tuioTimestamp();
+
+    qt_tuioRecordLatency(m_stats.dispatchLatency, m_stats.averageDispatchLatency, m_stats.maxDispatchLatency, latency);
+    if (m_immediate)
+        m_deliveredTimestamps.append(timestamp);
 }
 
 QT_END_NAMESPACE
@@ -36,18 +36,38 @@
 #define QTUIOHANDLER_P_H
 
 #include <QObject>
+#include <QHash>
+#include <QHostAddress>
 #include <QMap>
-#include <QUdpSocket>
+#include <QPointer>
+#include <QRectF>
+#include <QSet>
 #include <QVector>
 #include <QTransform>
 
 #include <qpa/qwindowsysteminterface.h>
 
+#include "qtuiocursor_p.h"
+#include "qtuiopacketfilter_p.h"
+#include "qtuiostats_p.h"
+#include "qtuiotransform_p.h"
+#include "qtuiocalibration_p.h"
+#include "qtuiofilter_p.h"
+#include "qtuiokinematics_p.h"
+#include "qtuioidallocator_p.h"
+#include "qtuioforwarder_p.h"
+#include "qoscwriter_p.h"
+#include "qtuiotrace_p.h"
+#include "qtuiosnapshot.h"
+
 QT_BEGIN_NAMESPACE
 
 class QTouchDevice;
+class QThread;
+class QTimer;
+class QOscBundle;
 class QOscMessage;
-class QTuioCursor;
+class QTuioWindowIndex;
 
 class QTuioHandler : public QObject
 {
@@ -57,21 +77,138 @@ public:
     explicit QTuioHandler(const QString &specification);
     virtual ~QTuioHandler();
 
+    const QTuioStats &stats() const { return m_stats; }
+
+    // Writes the frames recorded with the trace option to fileName (by
+    // default, the file given with it), see QTuioTrace::write.
+    Q_INVOKABLE bool writeTrace(const QString &fileName = QString());
+
 private slots:
-    void processPackets();
-    void process2DCurSource(const QOscMessage &message);
-    void process2DCurAlive(const QOscMessage &message);
-    void process2DCurSet(const QOscMessage &message);
-    void process2DCurFseq(const QOscMessage &message);
+    void processBundle(quint64 sourceId, const QOscBundle &bundle, const QTuioPacketTimes &times);
+    void addSource(quint64 sourceId, const QTuioSenderAddress &sender, quint16 port);
+    void logStatistics();
+    void flushPendingFrames();
+    void flushImmediateFrames();
+    void flushStitchedFrame();
+    void expireSources();
 
 private:
-    QWindowSystemInterface::TouchPoint cursorToTouchPoint(const QTuioCursor &tc, QWindow *win);
+    // Each tracker sending to us gets its own state, and its own touch
+    // device, so that cursors of different trackers never get mixed up.
+    struct Source {
+        Source() : device(0), index(0), timestamp(0) {}
+
+        QTouchDevice *device;
+        int index; // in the order they were first seen
+        qint64 timestamp; // when the bundle being processed (or the last one) arrived
+        QMap<int, QTuioCursor> activeCursors;
+        QVector<QTuioCursor> deadCursors;
+        QHash<int, QPointer<QWindow> > windows; // where each cursor was pressed
+
+        // where in the stitched surface this tracker's tile is (null if it
+        // isn't part of it), and the stitched IDs of its cursors
+        QRectF tile;
+        QHash<int, int> stitchedIds;
+
+        // the IDs its cursors are forwarded with, see forwardFrame
+        QHash<int, int> forwardedIds;
+    };
+
+    // Where the velocities and accelerations delivered come from, see the
+    // kinematics option.
+    enum Kinematics {
+        SenderKinematics,   // the tracker's
+        DerivedIfMissing,   // ours, where the tracker's are zero
+        DerivedKinematics   // always ours
+    };
+
+    // A tile= option: which tracker (by port, and optionally address) goes
+    // where in the stitched surface.
+    struct Tile {
+        QHostAddress address;
+        quint16 port;
+        QRectF rect;
+    };
+
+    // A touch event held back while the GUI thread is behind, see
+    // deliverTouchEvent.
+    struct PendingFrame {
+        QPointer<QWindow> window;
+        QTouchDevice *device;
+        qint64 timestamp;
+        QList<QList<QWindowSystemInterface::TouchPoint> > edges;
+        QList<QWindowSystemInterface::TouchPoint> points;
+        QVector<qint64> traceFrames; // the traced frames held back in it, see QTuioTrace::frame
+    };
+
+    Source &source(quint64 sourceId, const QRectF &tile = QRectF());
+
+    void processSource(Source &source, const QOscMessage &message);
+    void processAlive(Source &source, const QOscMessage &message, QTuioCursor::Profile profile);
+    void processSet(Source &source, const QOscMessage &message, QTuioCursor::Profile profile);
+    void processFseq(Source &source, const QOscMessage &message);
+
+    void dispatchFrame(Source &source);
+    void releaseSource(Source &source);
+    void forwardFrame(Source &source);
+    void updateHovering(Source &source);
+    void stitchFrame(Source &source);
+    void releaseStitchedCursor(int stitchedId);
+    void filterMovement(Source &source, const QSizeF &targetSize);
+    void dispatchToFocusWindow(Source &source);
+    void dispatchToWindows(Source &source);
+    void deliverTouchEvent(QWindow *win, QTouchDevice *device, const QList<QWindowSystemInterface::TouchPoint> &points, qint64 timestamp);
+    void sendTouchEvent(QWindow *win, QTouchDevice *device, const QList<QWindowSystemInterface::TouchPoint> &points, qint64 timestamp);
+    void mapCursors(const Source &source);
+    void mapPoints(QPointF *points, int count) const;
+    void publishSnapshot();
+    QPointF cursorVelocity(const QTuioCursor &tc) const;
+    float cursorAcceleration(const QTuioCursor &tc) const;
+    QWindowSystemInterface::TouchPoint cursorToTouchPoint(const QTuioCursor &tc, const QPointF &normalPosition, const QRectF &target);
 
     QTouchDevice *m_device;
-    QUdpSocket m_socket;
-    QMap<int, QTuioCursor> m_activeCursors;
-    QVector<QTuioCursor> m_deadCursors;
+    QHash<quint64, Source> m_sources;
+    int m_sourceCount; // ever seen
+    QVector<QTouchDevice *> m_spareDevices; // of expired sources
+    QTimer *m_sourceTimer;
+    QVector<QThread *> m_threads;
+    QTuioStats m_stats;
     QTransform m_transform;
+    QTuioMapFunction m_mapFunction;
+    QTuioCalibrationMesh m_calibrationMesh;
+    QVector<QPointF> m_positions;
+    QTuioWindowIndex *m_windowIndex;
+    qreal m_movementThreshold;
+    bool m_movementThresholdInPixels;
+    bool m_smoothing;
+    QTuioOneEuroFilter m_smoothingFilter;
+    Kinematics m_kinematics;
+    qreal m_hoverHeight;
+    QSet<QByteArray> m_unknownAddressPatterns;
+    int m_backpressureThreshold;
+    QTimer *m_backpressureTimer;
+    QVector<PendingFrame> m_pendingFrames;
+    bool m_immediate;
+    QTimer *m_immediateTimer;
+    QVector<qint64> m_deliveredTimestamps; // handed to Qt, not yet flushed
+    QTuioTrace *m_trace;
+    QTuioTrace::Frame *m_traceFrame; // of the bundle being processed
+    QString m_traceFileName;
+    QTuioForwarder m_forwarder; // forwardmapped=
+    QOscWriter m_writer;
+    QTuioIdAllocator m_forwardedIds;
+    QVector<QPair<const QTuioCursor *, int> > m_forwardedCursors; // of the frame being forwarded, with their IDs
+    quint32 m_forwardedFrame;
+    QTuioSnapshotBuffer *m_snapshot;
+
+    // stitching, see stitchFrame
+    QVector<Tile> m_tiles;
+    Source m_stitched;
+    QTuioIdAllocator m_stitchedIds;
+    QHash<int, qint64> m_seamCursors; // stitched ID -> until when it may be continued
+    qreal m_seamDistance;
+    int m_seamTimeout;
+    QTimer *m_stitchTimer;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOIDALLOCATOR_P_H
+#define QTUIOIDALLOCATOR_P_H
+
+#include <QtAlgorithms>
+#include <QVarLengthArray>
+
+QT_BEGIN_NAMESPACE
+
+// Hands out the lowest ID not in use, so IDs stay small and dense no matter
+// how many touches came and went, or what IDs the trackers use. One bit per
+// ID; finding a free one is a scan over a handful of words.
+class QTuioIdAllocator
+{
+public:
+    int allocate()
+    {
+        for (int i = 0; i < m_words.size(); ++i) {
+            if (m_words.at(i) != ~quint32(0)) {
+                const int bit = qCountTrailingZeroBits(~m_words.at(i));
+                m_words[i] |= quint32(1) << bit;
+                return i * 32 + bit;
+            }
+        }
+
+        m_words.append(1);
+        return (m_words.size() - 1) * 32;
+    }
+
+    void release(int id)
+    {
+        Q_ASSERT(id >= 0 && id / 32 < m_words.size());
+        m_words[id / 32] &= ~(quint32(1) << (id % 32));
+    }
+
+private:
+    QVarLengthArray<quint32, 4> m_words;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOIDALLOCATOR_P_H
@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOKINEMATICS_P_H
+#define QTUIOKINEMATICS_P_H
+
+#include <qmath.h>
+
+#include "qtuiocursor_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// Derives the cursor's velocity and acceleration from where it was over its
+// last few frames, as of timestamp (see qt_tuioTimestamp), for trackers that
+// send none, or nonsense (see the kinematics option).
+//
+// The positions are kept in a ring of QTuioMotionState::Size, so every frame
+// costs the same, however long the cursor has been around: the velocity is
+// taken across the whole ring, the acceleration is the change in speed from
+// its older half to its newer half. That spans a few frames, which evens out
+// both the tracker's jitter and that of the timestamps (they are taken when
+// the frame arrived, not when it was captured).
+inline void qt_tuioUpdateMotion(QTuioCursor &cursor, qint64 timestamp)
+{
+    QTuioMotionState &state = cursor.motionState();
+    const int size = QTuioMotionState::Size;
+
+    if (cursor.state() == Qt::TouchPointPressed)
+        state.count = 0;
+
+    // frames that arrived at the same time (read in one go after a stall)
+    // tell nothing about the time in between, the last one replaces the others
+    if (!state.count || state.timestamp[state.newest] != timestamp) {
+        state.newest = (state.newest + 1) % size;
+        state.count = qMin(state.count + 1, size);
+    }
+    state.x[state.newest] = cursor.x();
+    state.y[state.newest] = cursor.y();
+    state.timestamp[state.newest] = timestamp;
+
+    state.vx = 0;
+    state.vy = 0;
+    state.acceleration = 0;
+    if (state.count < 2)
+        return;
+
+    const int oldest = (state.newest - state.count + 1 + size) % size;
+    const qreal dt = (timestamp - state.timestamp[oldest]) / 1e9;
+    if (dt <= 0)
+        return;
+    state.vx = (state.x[state.newest] - state.x[oldest]) / dt;
+    state.vy = (state.y[state.newest] - state.y[oldest]) / dt;
+    if (state.count < 3)
+        return;
+
+    const int middle = (oldest + state.count / 2) % size;
+    const qreal olderDt = (state.timestamp[middle] - state.timestamp[oldest]) / 1e9;
+    const qreal newerDt = (timestamp - state.timestamp[middle]) / 1e9;
+    if (olderDt <= 0 || newerDt <= 0)
+        return;
+    const qreal olderDx = state.x[middle] - state.x[oldest];
+    const qreal olderDy = state.y[middle] - state.y[oldest];
+    const qreal newerDx = state.x[state.newest] - state.x[middle];
+    const qreal newerDy = state.y[state.newest] - state.y[middle];
+    const qreal olderSpeed = qSqrt(olderDx * olderDx + olderDy * olderDy) / olderDt;
+    const qreal newerSpeed = qSqrt(newerDx * newerDx + newerDy * newerDy) / newerDt;
+    state.acceleration = (newerSpeed - olderSpeed) / (dt / 2);
+}
+
+QT_END_NAMESPACE
+
+#endif // QTUIOKINEMATICS_P_H
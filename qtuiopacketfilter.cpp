@@ -0,0 +1,216 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtEndian>
+
+#include <string.h>
+
+#include "qtuiopacketfilter_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QTuioSenderAddress QTuioSenderAddress::fromIPv4(quint32 ipv4Address, quint16 port)
+{
+    QTuioSenderAddress sender;
+    sender.address[10] = 0xff;
+    sender.address[11] = 0xff;
+    qToBigEndian(ipv4Address, sender.address + 12);
+    sender.port = port;
+    return sender;
+}
+
+QTuioSenderAddress QTuioSenderAddress::fromIPv6(const quint8 *ipv6Address, quint16 port)
+{
+    QTuioSenderAddress sender;
+    memcpy(sender.address, ipv6Address, sizeof(sender.address));
+    sender.port = port;
+    return sender;
+}
+
+QTuioSenderAddress QTuioSenderAddress::fromHostAddress(const QHostAddress &hostAddress, quint16 port)
+{
+    if (hostAddress.protocol() == QAbstractSocket::IPv4Protocol)
+        return fromIPv4(hostAddress.toIPv4Address(), port);
+    const Q_IPV6ADDR ipv6Address = hostAddress.toIPv6Address();
+    return fromIPv6(ipv6Address.c, port);
+}
+
+bool QTuioSenderAddress::isIPv4() const
+{
+    static const quint8 prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+    return memcmp(address, prefix, sizeof(prefix)) == 0;
+}
+
+quint32 QTuioSenderAddress::toIPv4() const
+{
+    return qFromBigEndian<quint32>(address + 12);
+}
+
+QHostAddress QTuioSenderAddress::toHostAddress() const
+{
+    if (isIPv4())
+        return QHostAddress(toIPv4());
+    return QHostAddress(address);
+}
+
+QTuioPacketFilter::QTuioPacketFilter()
+    : m_packetsPerNSec(0)
+    , m_burst(0)
+{
+    m_clock.start();
+}
+
+bool QTuioPacketFilter::addAllowedSender(const QString &entry)
+{
+    QPair<QHostAddress, int> subnet;
+    if (entry.contains('/'))
+        subnet = QHostAddress::parseSubnet(entry);
+    else if (subnet.first.setAddress(entry))
+        subnet.second = subnet.first.protocol() == QAbstractSocket::IPv4Protocol ? 32 : 128;
+
+    if (subnet.first.isNull())
+        return false;
+
+    if (subnet.first.protocol() == QAbstractSocket::IPv4Protocol) {
+        const quint32 netmask = subnet.second ? ~quint32(0) << (32 - subnet.second) : 0;
+        m_allowedIPv4.append(qMakePair(subnet.first.toIPv4Address() & netmask, netmask));
+    } else {
+        m_allowedIPv6.append(qMakePair(QTuioSenderAddress::fromHostAddress(subnet.first, 0), subnet.second));
+    }
+
+    return true;
+}
+
+// Whether the first prefixLength bits of both addresses are the same.
+static bool qt_tuioPrefixMatches(const quint8 *address, const quint8 *network, int prefixLength)
+{
+    const int bytes = prefixLength / 8;
+    if (memcmp(address, network, bytes) != 0)
+        return false;
+    if (prefixLength % 8 == 0)
+        return true;
+    const quint8 mask = quint8(0xff << (8 - prefixLength % 8));
+    return (address[bytes] & mask) == (network[bytes] & mask);
+}
+
+bool QTuioPacketFilter::isAllowed(const QTuioSenderAddress &sender) const
+{
+    if (m_allowedIPv4.isEmpty() && m_allowedIPv6.isEmpty())
+        return true;
+
+    if (sender.isIPv4()) {
+        const quint32 address = sender.toIPv4();
+        for (int i = 0; i < m_allowedIPv4.count(); ++i) {
+            if ((address & m_allowedIPv4.at(i).second) == m_allowedIPv4.at(i).first)
+                return true;
+        }
+        return false;
+    }
+
+    for (int i = 0; i < m_allowedIPv6.count(); ++i) {
+        if (qt_tuioPrefixMatches(sender.address, m_allowedIPv6.at(i).first.address, m_allowedIPv6.at(i).second))
+            return true;
+    }
+    return false;
+}
+
+void QTuioPacketFilter::setRateLimit(int packetsPerSecond, int burst)
+{
+    m_packetsPerNSec = packetsPerSecond / 1e9;
+    m_burst = qMax(1, burst);
+}
+
+// A token bucket per sender: it holds up to burst tokens, refills at the
+// configured rate, and each datagram takes one.
+bool QTuioPacketFilter::takeToken(quint64 sender)
+{
+    if (m_packetsPerNSec <= 0)
+        return true;
+
+    const qint64 now = m_clock.nsecsElapsed();
+    QHash<quint64, Bucket>::Iterator it = m_buckets.find(sender);
+    if (it == m_buckets.end()) {
+        // don't let a stream of new senders grow this without bounds: forget
+        // about those that have been quiet long enough to be full again
+        // anyway, and if that isn't enough, about the one that has been
+        // quiet the longest.
+        if (m_buckets.size() >= MaxBuckets) {
+            const qint64 refillTime = m_burst / m_packetsPerNSec;
+            quint64 oldest = 0;
+            qint64 oldestRefill = now;
+            for (QHash<quint64, Bucket>::Iterator bucket = m_buckets.begin(); bucket != m_buckets.end();) {
+                if (now - bucket->lastRefill > refillTime) {
+                    bucket = m_buckets.erase(bucket);
+                } else {
+                    if (bucket->lastRefill <= oldestRefill) {
+                        oldest = bucket.key();
+                        oldestRefill = bucket->lastRefill;
+                    }
+                    ++bucket;
+                }
+            }
+            if (m_buckets.size() >= MaxBuckets)
+                m_buckets.remove(oldest);
+        }
+
+        Bucket bucket;
+        bucket.lastRefill = now;
+        bucket.tokens = m_burst;
+        it = m_buckets.insert(sender, bucket);
+    }
+
+    Bucket &bucket = *it;
+    bucket.tokens = qMin(m_burst, bucket.tokens + (now - bucket.lastRefill) * m_packetsPerNSec);
+    bucket.lastRefill = now;
+
+    if (bucket.tokens < 1)
+        return false;
+
+    bucket.tokens -= 1;
+    return true;
+}
+
+// TUIO is always sent as bundles: "#bundle\0", a time tag, and then elements,
+// each prefixed with its size, and all of it a multiple of 4 bytes long.
+bool QTuioPacketFilter::looksLikeBundle(const char *data, qint64 size)
+{
+    if (size < 20 || size % 4 != 0 || memcmp(data, "#bundle\0", 8) != 0)
+        return false;
+
+    // an empty (or no) first element means there is nothing in it for us.
+    const quint32 firstElementSize = qFromBigEndian<quint32>((const uchar *)data + 16);
+    return firstElementSize != 0 && firstElementSize <= quint32(size - 20) && firstElementSize % 4 == 0;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,122 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOPACKETFILTER_P_H
+#define QTUIOPACKETFILTER_P_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QMetaType>
+#include <QPair>
+#include <QVector>
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+// A sender's address and port, the way the kernel hands them to us. Unlike
+// QHostAddress, it can be made, compared and hashed without allocating, so
+// that datagrams from unwanted senders cost nothing but the read. IPv4
+// addresses are kept IPv4-mapped (::ffff:a.b.c.d), as an IPv6 socket would
+// report them.
+struct QTuioSenderAddress
+{
+    QTuioSenderAddress() : port(0) { memset(address, 0, sizeof(address)); }
+
+    static QTuioSenderAddress fromIPv4(quint32 ipv4Address, quint16 port);
+    static QTuioSenderAddress fromIPv6(const quint8 *ipv6Address, quint16 port);
+    static QTuioSenderAddress fromHostAddress(const QHostAddress &hostAddress, quint16 port);
+
+    bool isIPv4() const;
+    quint32 toIPv4() const;
+    QHostAddress toHostAddress() const;
+
+    quint8 address[16]; // in network byte order
+    quint16 port;
+};
+
+inline bool operator==(const QTuioSenderAddress &a, const QTuioSenderAddress &b)
+{
+    return a.port == b.port && memcmp(a.address, b.address, sizeof(a.address)) == 0;
+}
+
+inline uint qHash(const QTuioSenderAddress &sender, uint seed = 0)
+{
+    return qHash(sender.port, qHashBits(sender.address, sizeof(sender.address), seed));
+}
+
+// Decides which datagrams are worth parsing at all: only those from an allowed
+// sender, that look like an OSC bundle, and that are within their sender's
+// rate limit. Everything here works on the raw datagram, before any
+// allocation or parsing is done.
+//
+// Every receiver has its own copy, so no locking is needed; since the kernel
+// keeps a sender address and port on one socket, the rate of each is still
+// tracked in one place.
+class QTuioPacketFilter
+{
+public:
+    QTuioPacketFilter();
+
+    // Entries are addresses or subnets ("10.0.0.5", "10.0.1.0/24").
+    bool addAllowedSender(const QString &entry);
+    bool isAllowed(const QTuioSenderAddress &sender) const;
+
+    void setRateLimit(int packetsPerSecond, int burst);
+    bool takeToken(quint64 sender);
+
+    static bool looksLikeBundle(const char *data, qint64 size);
+
+private:
+    enum { MaxBuckets = 256 };
+
+    struct Bucket {
+        qint64 lastRefill;
+        double tokens;
+    };
+
+    QVector<QPair<quint32, quint32> > m_allowedIPv4; // network, netmask
+    QVector<QPair<QTuioSenderAddress, int> > m_allowedIPv6; // network, prefix length
+    double m_packetsPerNSec;
+    double m_burst;
+    QElapsedTimer m_clock;
+    QHash<quint64, Bucket> m_buckets;
+};
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QTuioSenderAddress)
+
+#endif // QTUIOPACKETFILTER_P_H
@@ -0,0 +1,235 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QDebug>
+#include <QThread>
+
+#if defined(Q_OS_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "qtuioshmtransport_p.h"
+#include "qtuiostats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QTuioShmTransport::QTuioShmTransport(const QString &name, int capacity, const QTuioPacketFilter &filter, QTuioStats *stats)
+    : QTuioTransport(filter, stats)
+    , m_name(name.startsWith('/') ? name : QLatin1Char('/') + name)
+    , m_capacity(quint32(qMax(4096, capacity)) & ~3u)
+    , m_source(newSource())
+    , m_fd(-1)
+    , m_header(0)
+    , m_ring(0)
+    , m_readPosition(0)
+{
+}
+
+#if defined(Q_OS_LINUX)
+
+QTuioShmTransport::~QTuioShmTransport()
+{
+    if (m_header) {
+        m_header->readerWaiting.storeRelease(0);
+        ::munmap(m_header, sizeof(QTuioShmHeader) + m_capacity);
+    }
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+// Creates the segment, unless the tracker already did.
+bool QTuioShmTransport::open()
+{
+    const QByteArray name = m_name.toLocal8Bit();
+    bool created = true;
+    m_fd = ::shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (m_fd < 0 && errno == EEXIST) {
+        created = false;
+        m_fd = ::shm_open(name.constData(), O_RDWR | O_CLOEXEC, 0);
+    }
+
+    if (m_fd < 0) {
+        qWarning() << "Failed to open TUIO shared memory" << m_name << ":" << qt_error_string(errno);
+        return false;
+    }
+
+    if (created) {
+        if (::ftruncate(m_fd, sizeof(QTuioShmHeader) + m_capacity) < 0) {
+            qWarning() << "Failed to size TUIO shared memory" << m_name << ":" << qt_error_string(errno);
+            return false;
+        }
+    } else {
+        struct stat st;
+        if (::fstat(m_fd, &st) < 0 || st.st_size < qint64(sizeof(QTuioShmHeader)) + 4096) {
+            qWarning() << "Ignoring TUIO shared memory" << m_name << "of unexpected size";
+            return false;
+        }
+        m_capacity = quint32(st.st_size - sizeof(QTuioShmHeader)) & ~3u;
+    }
+
+    void *memory = ::mmap(0, sizeof(QTuioShmHeader) + m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (memory == MAP_FAILED) {
+        qWarning() << "Failed to map TUIO shared memory" << m_name << ":" << qt_error_string(errno);
+        return false;
+    }
+
+    m_header = static_cast<QTuioShmHeader *>(memory);
+    m_ring = static_cast<const char *>(memory) + sizeof(QTuioShmHeader);
+
+    if (created) {
+        // fresh from ftruncate, so everything else is zero already
+        m_header->version = QTuioShmVersion;
+        m_header->capacity = m_capacity;
+        QAtomicInteger<quint32> *magic = reinterpret_cast<QAtomicInteger<quint32> *>(&m_header->magic);
+        magic->storeRelease(QTuioShmMagic);
+    } else if (m_header->magic != QTuioShmMagic || m_header->version != QTuioShmVersion ||
+               m_header->capacity != m_capacity) {
+        qWarning() << "Ignoring TUIO shared memory" << m_name << "with unexpected header";
+        ::munmap(memory, sizeof(QTuioShmHeader) + m_capacity);
+        m_header = 0;
+        return false;
+    }
+
+    // anything already in there is stale
+    m_readPosition = m_header->writePosition.loadAcquire();
+    m_header->readPosition.storeRelease(m_readPosition);
+    return true;
+}
+
+static int qt_futexWait(QAtomicInt *word, int expected, int timeoutMsecs)
+{
+    timespec timeout;
+    timeout.tv_sec = timeoutMsecs / 1000;
+    timeout.tv_nsec = (timeoutMsecs % 1000) * 1000000;
+    return ::syscall(SYS_futex, reinterpret_cast<int *>(word), FUTEX_WAIT, expected, &timeout, 0, 0);
+}
+
+// Processes records until the thread is asked to interrupt. While there's
+// nothing to read, it sleeps on the futex; the timeout is only there to notice
+// the interruption.
+void QTuioShmTransport::start()
+{
+    if (!open())
+        return;
+
+    QThread *thread = QThread::currentThread();
+    while (!thread->isInterruptionRequested()) {
+        processRecords();
+
+        // announce that we're about to sleep, then make sure nothing arrived
+        // in the meantime; the writer does the same the other way around.
+        const int sequence = m_header->sequence.loadAcquire();
+        m_header->readerWaiting.fetchAndStoreOrdered(1);
+        if (m_header->writePosition.loadAcquire() == m_readPosition)
+            qt_futexWait(&m_header->sequence, sequence, 100);
+        m_header->readerWaiting.storeRelease(0);
+    }
+}
+
+void QTuioShmTransport::processRecords()
+{
+    const quint64 writePosition = m_header->writePosition.loadAcquire();
+    if (writePosition == m_readPosition)
+        return;
+
+    const qint64 timestamp = qt_tuioTimestamp();
+
+    // the tracker is another process, so don't trust it any further than the
+    // socket stack would: if it breaks the protocol, skip everything it
+    // wrote. it can't have written backwards, or more than fits.
+    if (writePosition < m_readPosition || writePosition - m_readPosition > m_capacity)
+        skipMalformed(writePosition);
+
+    while (m_readPosition < writePosition) {
+        const quint32 offset = quint32(m_readPosition % m_capacity);
+        quint32 size;
+        memcpy(&size, m_ring + offset, sizeof(size));
+
+        if (size == QTuioShmWrap) {
+            // nor can it skip ahead of what it wrote
+            if (m_capacity - offset > writePosition - m_readPosition) {
+                skipMalformed(writePosition);
+                break;
+            }
+            m_readPosition += m_capacity - offset;
+            continue;
+        }
+
+        const quint32 recordSize = size <= m_capacity ? 4 + ((size + 3) & ~3u) : 0;
+        if (!recordSize || recordSize > m_capacity - offset || recordSize > writePosition - m_readPosition) {
+            skipMalformed(writePosition);
+            break;
+        }
+
+        processPacket(m_ring + offset + 4, size, m_source, timestamp);
+
+        // give the space back as soon as we're done with it
+        m_readPosition += recordSize;
+        m_header->readPosition.storeRelease(m_readPosition);
+    }
+
+    m_header->readPosition.storeRelease(m_readPosition);
+}
+
+// Counts the rest of what the tracker wrote as one malformed packet, and
+// carries on after it.
+void QTuioShmTransport::skipMalformed(quint64 writePosition)
+{
+    qt_tuioCount(m_stats->datagrams);
+    qt_tuioCount(m_stats->rejectedMalformed);
+    m_readPosition = writePosition;
+}
+
+#else
+
+QTuioShmTransport::~QTuioShmTransport()
+{
+}
+
+void QTuioShmTransport::start()
+{
+    qWarning() << "The TUIO shared memory transport is not supported on this platform";
+}
+
+#endif
+
+QT_END_NAMESPACE
@@ -0,0 +1,124 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOSHMTRANSPORT_P_H
+#define QTUIOSHMTRANSPORT_P_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QString>
+
+#include "qtuiotransport_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// The layout of the shared memory segment a tracker on the same host writes
+// its OSC bundles to, see QTuioShmTransport. All fields are in host byte
+// order.
+//
+// After the header comes a ring buffer of capacity bytes, holding records of
+// a 32-bit size, followed by that many bytes of bundle, padded to a multiple
+// of four. A record never wraps around: if it doesn't fit before the end of
+// the ring, the writer puts a size of QTuioShmWrap there and starts over at
+// the beginning.
+//
+// The positions count bytes ever written and read (so the offset into the
+// ring is position % capacity). To publish a record, the writer
+//  1. checks that capacity - (writePosition - readPosition) is enough room
+//     for it (dropping the bundle otherwise),
+//  2. copies it into the ring, and stores the new writePosition (release),
+//  3. increments sequence (sequentially consistent), and if readerWaiting is
+//     then set, wakes the reader: FUTEX_WAKE on sequence.
+struct QTuioShmHeader
+{
+    quint32 magic;     // QTuioShmMagic, once the segment is set up
+    quint32 version;   // QTuioShmVersion
+    quint32 capacity;  // of the ring, a multiple of 4
+    char padding0[52];
+
+    // written by the tracker
+    QAtomicInteger<quint64> writePosition;
+    QAtomicInt sequence; // the futex word
+    char padding1[52];
+
+    // written by us
+    QAtomicInteger<quint64> readPosition;
+    QAtomicInt readerWaiting;
+    char padding2[52];
+};
+
+static const quint32 QTuioShmMagic = 0x4f495554; // "TUIO"
+static const quint32 QTuioShmVersion = 1;
+static const quint32 QTuioShmWrap = 0xffffffff;
+
+// Receives TUIO bundles from a tracker running on the same host through a
+// shared memory ring buffer (see QTuioShmHeader), bypassing the socket stack
+// entirely. Records are checked and parsed in the ring, and copied out of it
+// only once, by the bundle they make, then handed over like any other
+// transport's.
+//
+// Waiting for the tracker blocks, so the transport must be moved to a thread
+// of its own; start() returns once the thread is asked to interrupt.
+//
+// Only supported on Linux.
+class QTuioShmTransport : public QTuioTransport
+{
+    Q_OBJECT
+
+public:
+    QTuioShmTransport(const QString &name, int capacity, const QTuioPacketFilter &filter, QTuioStats *stats);
+    ~QTuioShmTransport();
+
+    bool isBlocking() const { return true; }
+
+public slots:
+    void start();
+
+private:
+    bool open();
+    void processRecords();
+    void skipMalformed(quint64 writePosition);
+
+    QString m_name;
+    quint32 m_capacity;
+    quint64 m_source;
+    int m_fd;
+    QTuioShmHeader *m_header;
+    const char *m_ring;
+    quint64 m_readPosition;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOSHMTRANSPORT_P_H
@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QDebug>
+#include <QFile>
+#include <QSocketNotifier>
+
+#if defined(Q_OS_UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "qtuiosliptransport_p.h"
+#include "qtuiostats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    SlipEnd = 0xc0,
+    SlipEsc = 0xdb,
+    SlipEscEnd = 0xdc,
+    SlipEscEsc = 0xdd
+};
+
+QTuioSlipTransport::QTuioSlipTransport(const QString &path, const QTuioPacketFilter &filter, QTuioStats *stats)
+    : QTuioTransport(filter, stats)
+    , m_path(path)
+    , m_source(newSource())
+    , m_fd(-1)
+    , m_notifier(0)
+    , m_packetSize(0)
+    , m_escaped(false)
+    , m_overflow(false)
+{
+}
+
+QTuioSlipTransport::~QTuioSlipTransport()
+{
+    close();
+}
+
+// Unpacks data into the packet buffer, and hands on each packet completed.
+void QTuioSlipTransport::decode(const char *data, qint64 size, qint64 timestamp)
+{
+    char *packet = packetBuffer();
+
+    for (qint64 i = 0; i < size; ++i) {
+        uchar c = uchar(data[i]);
+
+        if (c == SlipEnd) {
+            // (an END with nothing before it just starts a packet)
+            if (m_overflow) {
+                qt_tuioCount(m_stats->datagrams);
+                qt_tuioCount(m_stats->rejectedMalformed);
+            } else if (m_packetSize > 0) {
+                processPacket(packet, m_packetSize, m_source, timestamp);
+            }
+            m_packetSize = 0;
+            m_escaped = false;
+            m_overflow = false;
+            continue;
+        }
+
+        if (m_escaped) {
+            // anything else after ESC is a protocol violation; RFC 1055 says
+            // to take the byte as it is
+            if (c == SlipEscEnd)
+                c = SlipEnd;
+            else if (c == SlipEscEsc)
+                c = SlipEsc;
+            m_escaped = false;
+        } else if (c == SlipEsc) {
+            m_escaped = true;
+            continue;
+        }
+
+        if (m_packetSize == qt_tuioMaxPacketSize) {
+            m_overflow = true;
+            continue;
+        }
+
+        packet[m_packetSize++] = char(c);
+    }
+}
+
+#if defined(Q_OS_UNIX)
+
+bool QTuioSlipTransport::open()
+{
+    if (m_path == QLatin1String("-")) {
+        m_fd = STDIN_FILENO;
+    } else {
+        // non-blocking, or this would wait for a writer to show up
+        m_fd = ::open(QFile::encodeName(m_path).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (m_fd < 0) {
+            qWarning() << "Failed to open TUIO stream" << m_path << ":" << qt_error_string(errno);
+            return false;
+        }
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &QTuioSlipTransport::readData);
+    return true;
+}
+
+void QTuioSlipTransport::close()
+{
+    // (this may be called from the notifier's own signal)
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = 0;
+    }
+    if (m_fd > STDIN_FILENO)
+        ::close(m_fd);
+    m_fd = -1;
+
+    m_packetSize = 0;
+    m_escaped = false;
+    m_overflow = false;
+}
+
+void QTuioSlipTransport::start()
+{
+    m_readBuffer.resize(qt_tuioMaxPacketSize);
+    packetBuffer();
+    open();
+}
+
+// One read per notification: the notifier says there's something to read,
+// so it doesn't block, even on a blocking stdin.
+void QTuioSlipTransport::readData()
+{
+    const ssize_t size = ::read(m_fd, m_readBuffer.data(), m_readBuffer.size());
+    if (size < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            qWarning() << "Failed to read from TUIO stream" << m_path << ":" << qt_error_string(errno);
+            close();
+        }
+        return;
+    }
+
+    if (size == 0) {
+        // the writer is gone. stdin is done for good, a pipe waits for the
+        // next writer.
+        const bool reopen = m_fd != STDIN_FILENO;
+        close();
+        if (reopen)
+            open();
+        return;
+    }
+
+    decode(m_readBuffer.constData(), size, qt_tuioTimestamp());
+}
+
+#else
+
+bool QTuioSlipTransport::open()
+{
+    return false;
+}
+
+void QTuioSlipTransport::close()
+{
+}
+
+void QTuioSlipTransport::start()
+{
+    qWarning() << "TUIO streams are not supported on this platform";
+}
+
+void QTuioSlipTransport::readData()
+{
+}
+
+#endif
+
+QT_END_NAMESPACE
@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOSLIPTRANSPORT_P_H
+#define QTUIOSLIPTRANSPORT_P_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "qtuiotransport_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+
+// Reads TUIO packets from a stream, a named pipe or stdin ("-"), framed with
+// SLIP (RFC 1055) as OSC 1.1 does for streams: each packet is followed (and
+// may be preceded) by an END byte, with END and ESC bytes inside it escaped.
+// Meant for piping captured traffic into an application, and for trackers
+// that would rather write to a pipe. Everything read from the stream is one
+// source.
+//
+// A named pipe is reopened when the writer goes away, so the next writer can
+// connect; stdin is read until it ends.
+//
+// Only supported on Unix.
+class QTuioSlipTransport : public QTuioTransport
+{
+    Q_OBJECT
+
+public:
+    QTuioSlipTransport(const QString &path, const QTuioPacketFilter &filter, QTuioStats *stats);
+    ~QTuioSlipTransport();
+
+public slots:
+    void start();
+
+private slots:
+    void readData();
+
+private:
+    bool open();
+    void close();
+    void decode(const char *data, qint64 size, qint64 timestamp);
+
+    QString m_path;
+    quint64 m_source;
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QByteArray m_readBuffer; // what was read, before decoding
+    int m_packetSize;        // decoded into packetBuffer() so far
+    bool m_escaped;
+    bool m_overflow;         // the packet is too large, skip to the next END
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOSLIPTRANSPORT_P_H
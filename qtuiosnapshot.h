@@ -0,0 +1,153 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOSNAPSHOT_H
+#define QTUIOSNAPSHOT_H
+
+//
+// Unlike the rest of the plugin, this header is meant to be used by
+// applications: copy it into your project, start the plugin with the snapshot
+// option, and poll qt_tuioSnapshotBuffer() for where all touches are right
+// now, from any thread, e.g. while building the next frame on the Qt Quick
+// render thread. Reading takes no locks and allocates nothing.
+//
+
+#include <QCoreApplication>
+#include <QVariant>
+
+#include <atomic>
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+struct QTuioSnapshotPoint
+{
+    int id;       // as in the touch events
+    int source;   // which tracker: 0 for the first one (or the stitched surface)
+    float x;      // normalized, mapped like QTouchEvent::TouchPoint::normalizedPos
+    float y;
+    float vx;     // normalized units per second, mapped the same way
+    float vy;
+};
+
+struct QTuioSnapshot
+{
+    enum { Capacity = 128 };
+
+    quint32 frame;     // changes with every frame published
+    qint64 timestamp;  // when its bundle arrived, like QElapsedTimer::msecsSinceReference
+    int count;         // at most Capacity, further touches are left out
+    QTuioSnapshotPoint points[Capacity];
+};
+
+// A seqlock around the latest QTuioSnapshot. The handler (the only writer)
+// makes the sequence odd while it publishes a frame; readers copy the
+// snapshot out, and try again if the sequence was odd, or changed meanwhile.
+class QTuioSnapshotBuffer
+{
+public:
+    enum { Version = 1 };
+
+    QTuioSnapshotBuffer()
+        : m_version(Version)
+    {
+        m_sequence.store(0);
+        memset(&m_snapshot, 0, sizeof(m_snapshot));
+    }
+
+    int version() const { return m_version; }
+
+    // Copies the latest snapshot into snapshot (only as many points as it
+    // has). Only ever spins while a frame is being published, which takes
+    // microseconds.
+    void read(QTuioSnapshot *snapshot) const
+    {
+        for (;;) {
+            const int before = m_sequence.loadAcquire();
+            if (before & 1)
+                continue;
+
+            snapshot->frame = m_snapshot.frame;
+            snapshot->timestamp = m_snapshot.timestamp;
+            snapshot->count = qBound(0, m_snapshot.count, int(QTuioSnapshot::Capacity));
+            memcpy(snapshot->points, m_snapshot.points, snapshot->count * sizeof(QTuioSnapshotPoint));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load() == before)
+                return;
+        }
+    }
+
+    // For the handler: brackets the changes to the snapshot returned.
+    QTuioSnapshot &beginWrite()
+    {
+        m_sequence.store(m_sequence.load() + 1);
+        std::atomic_thread_fence(std::memory_order_release);
+        return m_snapshot;
+    }
+
+    void endWrite()
+    {
+        ++m_snapshot.frame;
+        m_sequence.storeRelease(m_sequence.load() + 1);
+    }
+
+private:
+    Q_DISABLE_COPY(QTuioSnapshotBuffer)
+
+    const int m_version;
+    QAtomicInt m_sequence;
+    QTuioSnapshot m_snapshot;
+};
+
+// The snapshot buffer of the running TuioTouch plugin, or null if it isn't
+// loaded, was started without the snapshot option, or is of another version
+// of this header. Call it once, from the GUI thread; the buffer stays valid
+// until the application object is destroyed.
+inline const QTuioSnapshotBuffer *qt_tuioSnapshotBuffer()
+{
+    if (!qApp)
+        return 0;
+
+    const QTuioSnapshotBuffer *buffer =
+            reinterpret_cast<const QTuioSnapshotBuffer *>(qApp->property("_q_tuioSnapshot").value<quintptr>());
+    if (buffer && buffer->version() != QTuioSnapshotBuffer::Version)
+        return 0;
+
+    return buffer;
+}
+
+QT_END_NAMESPACE
+
+#endif // QTUIOSNAPSHOT_H
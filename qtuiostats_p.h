@@ -0,0 +1,112 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOSTATS_P_H
+#define QTUIOSTATS_P_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+
+// Counters shared between the handler and its receivers, which may be living
+// on threads of their own. They are only ever touched with relaxed
+// operations, so counting costs next to nothing.
+struct QTuioStats
+{
+    QAtomicInt datagrams;         // read from a socket
+    QAtomicInt rejectedSender;    // sender not on the allow-list, or too many senders at once
+    QAtomicInt rejectedMalformed; // not even looking like an OSC bundle
+    QAtomicInt rejectedRate;      // over its sender's rate limit
+    QAtomicInt invalidBundles;    // looked like a bundle, but failed to parse
+    QAtomicInt bundles;           // parsed and handed on to the handler
+    QAtomicInt kernelDrops;       // dropped by the kernel, our receive buffer was full
+
+    // window system events outstanding when the last frame was delivered
+    // (only set with backpressure enabled), and the most seen.
+    QAtomicInt queueDepth;
+    QAtomicInt maxQueueDepth;
+    QAtomicInt droppedFrames;     // merged into a later frame (backpressure, or immediate delivery)
+
+    // time from a datagram arriving (as timestamped by the kernel, where
+    // possible) to its touch event being handed to Qt, in microseconds: the
+    // last one, a moving average, and the most seen.
+    QAtomicInt dispatchLatency;
+    QAtomicInt averageDispatchLatency;
+    QAtomicInt maxDispatchLatency;
+
+    // the same, but up to the application having handled the touch event.
+    // only known with immediate delivery, where that happens right away.
+    QAtomicInt deliveryLatency;
+    QAtomicInt averageDeliveryLatency;
+    QAtomicInt maxDeliveryLatency;
+};
+
+inline void qt_tuioCount(QAtomicInt &counter, int amount = 1)
+{
+    counter.fetchAndAddRelaxed(amount);
+}
+
+// Records a latency in nanoseconds into one of the last/average/maximum
+// triplets above, in microseconds. Only ever called from one thread.
+inline void qt_tuioRecordLatency(QAtomicInt &last, QAtomicInt &average, QAtomicInt &maximum, qint64 latency)
+{
+    const int usecs = int(qMin(qMax(Q_INT64_C(0), latency) / 1000, Q_INT64_C(0x7fffffff)));
+    const int oldAverage = average.load();
+    last.store(usecs);
+    average.store(oldAverage + (usecs - oldAverage) / 16);
+    if (usecs > maximum.load())
+        maximum.store(usecs);
+}
+
+// The clock all timestamps in the plugin are taken from: monotonic, shared by
+// all threads, started when first used.
+inline const QElapsedTimer &qt_tuioClock()
+{
+    struct Clock : QElapsedTimer {
+        Clock() { start(); }
+    };
+    static Clock clock;
+    return clock;
+}
+
+// Now, in nanoseconds on qt_tuioClock.
+inline qint64 qt_tuioTimestamp()
+{
+    return qt_tuioClock().nsecsElapsed();
+}
+
+QT_END_NAMESPACE
+
+#endif // QTUIOSTATS_P_H
@@ -0,0 +1,1514 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTouchEvent>
+#include <QUdpSocket>
+#include <QWindow>
+#include <QtEndian>
+
+#include <qpa/qwindowsysteminterface.h>
+#include <qpa/qwindowsysteminterface_p.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <sys/mman.h>
+#endif
+
+#include "../qoscbundle_p.h"
+#include "../qtuiohandler_p.h"
+#include "../qtuiopacketfilter_p.h"
+#include "../qtuioshmtransport_p.h"
+#include "../qtuiosnapshot.h"
+#include "../qtuiostats_p.h"
+#include "../qtuiotrace_p.h"
+#include "../qtuiotransform_p.h"
+
+// Runs the handler for real, on the offscreen platform: TUIO bundles go out
+// over loopback UDP, and come back as touch events on a window.
+
+struct TouchRecord
+{
+    QEvent::Type type;
+    QList<QTouchEvent::TouchPoint> points;
+    qint64 timestamp; // qt_tuioTimestamp when it arrived
+    ulong eventTime; // the event's own timestamp
+};
+
+static Qt::TouchPointStates touchPointStates(const TouchRecord &record)
+{
+    Qt::TouchPointStates states = 0;
+    foreach (const QTouchEvent::TouchPoint &point, record.points)
+        states |= point.state();
+    return states;
+}
+
+class TouchWindow : public QWindow
+{
+public:
+    QVector<TouchRecord> events;
+
+protected:
+    void touchEvent(QTouchEvent *event)
+    {
+        TouchRecord record;
+        record.type = event->type();
+        record.points = event->touchPoints();
+        record.timestamp = qt_tuioTimestamp();
+        record.eventTime = event->timestamp();
+        events.append(record);
+        event->accept();
+    }
+};
+
+struct Cursor
+{
+    Cursor(int id = 0, float x = 0, float y = 0, float z = 0) : id(id), x(x), y(y), z(z) {}
+
+    int id;
+    float x;
+    float y;
+    float z; // only sent with the 2.5D and 3D profiles
+};
+
+static void appendOscString(QByteArray &out, const QByteArray &string)
+{
+    out += string;
+    out += char(0);
+    while (out.size() % 4)
+        out += char(0);
+}
+
+static void appendOscInt(QByteArray &out, qint32 value)
+{
+    uchar bytes[4];
+    qToBigEndian(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+static void appendOscFloat(QByteArray &out, float value)
+{
+    qint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    appendOscInt(out, bits);
+}
+
+static void appendBundleElement(QByteArray &bundle, const QByteArray &message)
+{
+    appendOscInt(bundle, message.size());
+    bundle += message;
+}
+
+// A TUIO 1.1 2Dcur (or 25Dcur or 3Dcur) frame: ALIVE with all of the
+// cursors, a SET for each, and FSEQ.
+static QByteArray tuioFrame(const QVector<Cursor> &cursors, int frameId, const QByteArray &profile = "/tuio/2Dcur")
+{
+    const bool depth = profile != "/tuio/2Dcur";
+
+    QByteArray bundle;
+    appendOscString(bundle, "#bundle");
+    appendOscInt(bundle, 0);
+    appendOscInt(bundle, 1); // "immediately"
+
+    QByteArray alive;
+    appendOscString(alive, profile);
+    appendOscString(alive, ",s" + QByteArray(cursors.size(), 'i'));
+    appendOscString(alive, "alive");
+    foreach (const Cursor &cursor, cursors)
+        appendOscInt(alive, cursor.id);
+    appendBundleElement(bundle, alive);
+
+    foreach (const Cursor &cursor, cursors) {
+        QByteArray set;
+        appendOscString(set, profile);
+        appendOscString(set, depth ? ",sifffffff" : ",sifffff");
+        appendOscString(set, "set");
+        appendOscInt(set, cursor.id);
+        appendOscFloat(set, cursor.x);
+        appendOscFloat(set, cursor.y);
+        if (depth)
+            appendOscFloat(set, cursor.z);
+        appendOscFloat(set, 0);
+        appendOscFloat(set, 0);
+        if (depth)
+            appendOscFloat(set, 0);
+        appendOscFloat(set, 0);
+        appendBundleElement(bundle, set);
+    }
+
+    QByteArray fseq;
+    appendOscString(fseq, profile);
+    appendOscString(fseq, ",si");
+    appendOscString(fseq, "fseq");
+    appendOscInt(fseq, frameId);
+    appendBundleElement(bundle, fseq);
+
+    return bundle;
+}
+
+// A frame with one cursor of a 3D profile (3Dcur or 3Dobj), with values
+// following the session ID in its SET (and for 3Dobj, a class ID of 42).
+static QByteArray tuioDepthFrame(const QByteArray &profile, int id, const QVector<float> &values, int frameId)
+{
+    const bool object = profile == "/tuio/3Dobj";
+
+    QByteArray bundle;
+    appendOscString(bundle, "#bundle");
+    appendOscInt(bundle, 0);
+    appendOscInt(bundle, 1); // "immediately"
+
+    QByteArray alive;
+    appendOscString(alive, profile);
+    appendOscString(alive, ",si");
+    appendOscString(alive, "alive");
+    appendOscInt(alive, id);
+    appendBundleElement(bundle, alive);
+
+    QByteArray set;
+    appendOscString(set, profile);
+    appendOscString(set, QByteArray(object ? ",sii" : ",si") + QByteArray(values.size(), 'f'));
+    appendOscString(set, "set");
+    appendOscInt(set, id);
+    if (object)
+        appendOscInt(set, 42);
+    foreach (float value, values)
+        appendOscFloat(set, value);
+    appendBundleElement(bundle, set);
+
+    QByteArray fseq;
+    appendOscString(fseq, profile);
+    appendOscString(fseq, ",si");
+    appendOscString(fseq, "fseq");
+    appendOscInt(fseq, frameId);
+    appendBundleElement(bundle, fseq);
+
+    return bundle;
+}
+
+// SLIP framing, as for the fifo= transport: END, the packet with END and ESC
+// escaped, END.
+static QByteArray slipEncode(const QByteArray &packet)
+{
+    QByteArray out;
+    out += char(0xc0);
+    for (int i = 0; i < packet.size(); ++i) {
+        if (uchar(packet.at(i)) == 0xc0)
+            out += "\xdb\xdc";
+        else if (uchar(packet.at(i)) == 0xdb)
+            out += "\xdb\xdd";
+        else
+            out += packet.at(i);
+    }
+    out += char(0xc0);
+    return out;
+}
+
+class tst_tuio : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void pressMoveRelease();
+    void twoCursors();
+    void movementThreshold();
+    void stitchedTiles();
+    void overlappingWindows();
+    void slipStream();
+    void unixDatagrams();
+    void shmWrapOverrun();
+    void senderFilter();
+    void dualStack();
+    void kernelDrops();
+    void kernelTimestamps();
+    void rateLimit();
+    void mapFunctions_data();
+    void mapFunctions();
+    void forwardMerged();
+    void immediateMerge();
+    void backpressure();
+    void trace();
+    void snapshot();
+    void calibrationMesh();
+    void hover();
+    void depthProfiles();
+    void kinematics();
+    void smoothing();
+    void latency_data();
+    void latency();
+
+signals:
+    void bundleReceived(quint64 sourceId, const QOscBundle &bundle, const QTuioPacketTimes &times);
+
+private:
+    void sendFrame(const QVector<Cursor> &cursors, quint16 port = 0);
+    void receiveFrame(const QVector<Cursor> &cursors);
+    void stall(QWindow *window, int events);
+    bool waitForEvents(int count, int timeout = 2000);
+
+    TouchWindow *m_window;
+    QTuioHandler *m_handler;
+    QUdpSocket m_sender;
+    quint16 m_port;
+    int m_frameId;
+};
+
+void tst_tuio::init()
+{
+    m_window = new TouchWindow;
+    m_window->setGeometry(0, 0, 400, 400);
+    m_window->show();
+    m_window->requestActivate();
+    QVERIFY(QTest::qWaitForWindowActive(m_window));
+
+    // find a free port
+    QUdpSocket probe;
+    QVERIFY(probe.bind(QHostAddress::LocalHost, 0));
+    m_port = probe.localPort();
+    probe.close();
+
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1").arg(m_port));
+    m_frameId = 0;
+}
+
+void tst_tuio::cleanup()
+{
+    delete m_handler;
+    m_handler = 0;
+    delete m_window;
+    m_window = 0;
+}
+
+void tst_tuio::sendFrame(const QVector<Cursor> &cursors, quint16 port)
+{
+    const QByteArray frame = tuioFrame(cursors, ++m_frameId);
+    QCOMPARE(m_sender.writeDatagram(frame, QHostAddress::LocalHost, port ? port : m_port), qint64(frame.size()));
+}
+
+// Hands a frame to the handler directly, as a transport would, so that it
+// arrives without going through the event loop.
+void tst_tuio::receiveFrame(const QVector<Cursor> &cursors)
+{
+    QTuioPacketTimes times;
+    times.received = qt_tuioTimestamp();
+    emit bundleReceived(1, QOscBundle(tuioFrame(cursors, ++m_frameId)), times);
+}
+
+// Makes it look like the GUI thread has fallen behind: window system events
+// pile up, until we get back to the event loop.
+void tst_tuio::stall(QWindow *window, int events)
+{
+    for (int i = 0; i < events; ++i)
+        QWindowSystemInterface::handleMouseEvent(window, QPointF(i, i), window->mapToGlobal(QPoint(i, i)), Qt::NoButton);
+}
+
+// Spins the event loop (rather than sleeping in it, like QTest::qWait) until
+// count touch events have arrived, so that latencies aren't rounded up to the
+// next timer tick.
+bool tst_tuio::waitForEvents(int count, int timeout)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (m_window->events.size() < count && timer.elapsed() < timeout)
+        QCoreApplication::processEvents(QEventLoop::AllEvents);
+    return m_window->events.size() >= count;
+}
+
+void tst_tuio::pressMoveRelease()
+{
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.25f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    cursors[0].x = 0.75f;
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(2));
+
+    // a frame in which nothing changed isn't delivered
+    sendFrame(cursors);
+
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(3));
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 3);
+
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 1);
+    QCOMPARE(events.at(0).points.at(0).state(), Qt::TouchPointPressed);
+    QVERIFY(qAbs(events.at(0).points.at(0).pos().x() - 200) < 1);
+    QVERIFY(qAbs(events.at(0).points.at(0).pos().y() - 100) < 1);
+
+    QCOMPARE(events.at(1).type, QEvent::TouchUpdate);
+    QCOMPARE(events.at(1).points.size(), 1);
+    QCOMPARE(events.at(1).points.at(0).state(), Qt::TouchPointMoved);
+    QVERIFY(qAbs(events.at(1).points.at(0).pos().x() - 300) < 1);
+
+    QCOMPARE(events.at(2).type, QEvent::TouchEnd);
+    QCOMPARE(events.at(2).points.size(), 1);
+    QCOMPARE(events.at(2).points.at(0).state(), Qt::TouchPointReleased);
+}
+
+void tst_tuio::twoCursors()
+{
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.25f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    cursors.append(Cursor(2, 0.75f, 0.75f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(2));
+
+    cursors.remove(0);
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(3));
+
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(4));
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 4);
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+
+    QCOMPARE(events.at(1).type, QEvent::TouchUpdate);
+    QCOMPARE(events.at(1).points.size(), 2);
+    QCOMPARE(touchPointStates(events.at(1)), Qt::TouchPointStationary | Qt::TouchPointPressed);
+
+    QCOMPARE(events.at(2).type, QEvent::TouchUpdate);
+    QCOMPARE(events.at(2).points.size(), 2);
+    QCOMPARE(touchPointStates(events.at(2)), Qt::TouchPointStationary | Qt::TouchPointReleased);
+
+    QCOMPARE(events.at(3).type, QEvent::TouchEnd);
+    QCOMPARE(events.at(3).points.size(), 1);
+    QCOMPARE(events.at(3).points.at(0).state(), Qt::TouchPointReleased);
+}
+
+// A touch at rest jitters without moving, then moves once it gets further than
+// the threshold, keeps moving in steps of a quarter of that, and comes to rest
+// in smaller ones.
+void tst_tuio::movementThreshold()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:threshold=10px").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.5f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    // 4px, then 2px the other way: nothing
+    const float steps[] = { 0.51f, 0.495f, 0.53f, 0.5375f, 0.54f, 0.55f };
+    for (int i = 0; i < 2; ++i) {
+        cursors[0].x = steps[i];
+        sendFrame(cursors);
+    }
+
+    // 12px from where it was pressed: moved
+    cursors[0].x = steps[2];
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(2));
+
+    // 3px: still moving; then 1px: at rest again, so 4px more isn't enough
+    for (int i = 3; i < 6; ++i) {
+        cursors[0].x = steps[i];
+        sendFrame(cursors);
+    }
+    QVERIFY(waitForEvents(3));
+
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(4));
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 4);
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(1).type, QEvent::TouchUpdate);
+    QCOMPARE(events.at(1).points.at(0).state(), Qt::TouchPointMoved);
+    QVERIFY(qAbs(events.at(1).points.at(0).pos().x() - 212) < 0.5);
+    QCOMPARE(events.at(2).points.at(0).state(), Qt::TouchPointMoved);
+    QVERIFY(qAbs(events.at(2).points.at(0).pos().x() - 215) < 0.5);
+    QCOMPARE(events.at(3).type, QEvent::TouchEnd);
+
+    // released where it was last delivered
+    QVERIFY(qAbs(events.at(3).points.at(0).pos().x() - 215) < 0.5);
+}
+
+// Two trackers side by side, using the same cursor IDs. A finger crossing
+// from one into the other must stay the same touch.
+void tst_tuio::stitchedTiles()
+{
+    QUdpSocket probe;
+    QVERIFY(probe.bind(QHostAddress::LocalHost, 0));
+    const quint16 rightPort = probe.localPort();
+    probe.close();
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1,127.0.0.1@%2:tile=%1,0,0,0.5,1:tile=%2,0.5,0,0.5,1:seam=0.05,500")
+                                 .arg(m_port).arg(rightPort));
+
+    QVector<Cursor> left;
+    left.append(Cursor(1, 0.5f, 0.5f));
+    sendFrame(left);
+    QVERIFY(waitForEvents(1));
+
+    QVector<Cursor> right;
+    right.append(Cursor(1, 0.5f, 0.5f));
+    sendFrame(right, rightPort);
+    QVERIFY(waitForEvents(2));
+
+    // the left one moves to the seam, and over it
+    left[0].x = 0.98f;
+    sendFrame(left);
+    QVERIFY(waitForEvents(3));
+    sendFrame(QVector<Cursor>());
+    right.append(Cursor(2, 0.02f, 0.5f));
+    sendFrame(right, rightPort);
+    QVERIFY(waitForEvents(4));
+
+    // and, away from the seam, everything is let go
+    right[1].x = 0.5f;
+    sendFrame(right, rightPort);
+    QVERIFY(waitForEvents(5));
+    sendFrame(QVector<Cursor>(), rightPort);
+    QVERIFY(waitForEvents(6));
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 6);
+
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 1);
+    QVERIFY(qAbs(events.at(0).points.at(0).pos().x() - 100) < 1);
+
+    QCOMPARE(events.at(1).points.size(), 2);
+    QCOMPARE(touchPointStates(events.at(1)), Qt::TouchPointStationary | Qt::TouchPointPressed);
+    QVERIFY(events.at(1).points.at(0).id() != events.at(1).points.at(1).id());
+
+    // no release and press at the seam, just a move
+    QCOMPARE(events.at(3).type, QEvent::TouchUpdate);
+    QCOMPARE(events.at(3).points.size(), 2);
+    QCOMPARE(touchPointStates(events.at(3)) & (Qt::TouchPointPressed | Qt::TouchPointReleased), Qt::TouchPointStates(0));
+    QCOMPARE(events.at(3).points.at(0).id(), events.at(1).points.at(0).id());
+    QCOMPARE(events.at(3).points.at(1).id(), events.at(1).points.at(1).id());
+
+    QCOMPARE(events.at(5).type, QEvent::TouchEnd);
+    QCOMPARE(events.at(5).points.size(), 2);
+}
+
+// With screen, each touch goes to the window it was pressed in, which where
+// windows overlap is the one activated last, and stays with it.
+void tst_tuio::overlappingWindows()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:screen").arg(m_port));
+
+    const QRect screen = QGuiApplication::primaryScreen()->geometry();
+    TouchWindow top;
+    top.setGeometry(200, 200, 400, 400);
+    top.show();
+    top.requestActivate();
+    QVERIFY(QTest::qWaitForWindowActive(&top));
+
+    // in both windows, and in m_window only
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 300.0f / screen.width(), 300.0f / screen.height()));
+    cursors.append(Cursor(2, 100.0f / screen.width(), 100.0f / screen.height()));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+    QTRY_COMPARE(top.events.size(), 1);
+
+    // the one on top moves out of it, over m_window
+    cursors[0].x = 150.0f / screen.width();
+    sendFrame(cursors);
+    QTRY_COMPARE(top.events.size(), 2);
+    sendFrame(QVector<Cursor>());
+    QTRY_COMPARE(top.events.size(), 3);
+    QVERIFY(waitForEvents(2));
+
+    // once m_window is activated again, it is the one on top
+    m_window->requestActivate();
+    QVERIFY(QTest::qWaitForWindowActive(m_window));
+    cursors.remove(1);
+    cursors[0].x = 300.0f / screen.width();
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(3));
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(4));
+
+    QCOMPARE(top.events.size(), 3);
+    QCOMPARE(top.events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(top.events.at(0).points.size(), 1);
+    QVERIFY(qAbs(top.events.at(0).points.at(0).pos().x() - 100) < 1);
+    QVERIFY(qAbs(top.events.at(0).points.at(0).pos().y() - 100) < 1);
+    QCOMPARE(top.events.at(1).points.at(0).state(), Qt::TouchPointMoved);
+    QVERIFY(qAbs(top.events.at(1).points.at(0).pos().x() - -50) < 1);
+    QCOMPARE(top.events.at(2).type, QEvent::TouchEnd);
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 4);
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 1);
+    QVERIFY(qAbs(events.at(0).points.at(0).pos().x() - 100) < 1);
+    QCOMPARE(events.at(1).type, QEvent::TouchEnd);
+    QCOMPARE(events.at(2).type, QEvent::TouchBegin);
+    QVERIFY(qAbs(events.at(2).points.at(0).pos().x() - 300) < 1);
+    QVERIFY(qAbs(events.at(2).points.at(0).pos().y() - 300) < 1);
+    QCOMPARE(events.at(3).type, QEvent::TouchEnd);
+}
+
+void tst_tuio::slipStream()
+{
+#if !defined(Q_OS_UNIX)
+    QSKIP("Named pipes are only supported on Unix");
+#else
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QByteArray path = QFile::encodeName(dir.path() + QStringLiteral("/tuio"));
+    QCOMPARE(::mkfifo(path.constData(), 0600), 0);
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("fifo=") + QFile::decodeName(path));
+
+    // the handler has the pipe open for reading, so this doesn't block
+    const int fd = ::open(path.constData(), O_WRONLY | O_NONBLOCK);
+    QVERIFY(fd >= 0);
+
+    // IDs that need escaping: 0xc0 is END, 0xdb is ESC
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(0xc0, 0.25f, 0.25f));
+    cursors.append(Cursor(0xdb, 0.75f, 0.75f));
+    QByteArray data = slipEncode(tuioFrame(cursors, 1));
+
+    // and a packet split over two writes
+    cursors[0].x = 0.5f;
+    const QByteArray second = slipEncode(tuioFrame(cursors, 2));
+    data += second.left(second.size() / 2);
+    QCOMPARE(::write(fd, data.constData(), data.size()), ssize_t(data.size()));
+    QVERIFY(waitForEvents(1));
+
+    data = second.mid(second.size() / 2) + slipEncode(tuioFrame(QVector<Cursor>(), 3));
+    QCOMPARE(::write(fd, data.constData(), data.size()), ssize_t(data.size()));
+    QVERIFY(waitForEvents(3));
+    ::close(fd);
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 3);
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 2);
+    QCOMPARE(events.at(1).type, QEvent::TouchUpdate);
+    QCOMPARE(touchPointStates(events.at(1)), Qt::TouchPointStationary | Qt::TouchPointMoved);
+    QCOMPARE(events.at(2).type, QEvent::TouchEnd);
+#endif
+}
+
+// A tracker writing into shared memory can't make us read past what it wrote,
+// with a wrap marker that skips further than that: the rest is dropped, and
+// reading carries on with the next record.
+#if defined(Q_OS_UNIX)
+static bool unixSocketAddress(const QString &fileName, sockaddr_un *sa)
+{
+    const QByteArray path = QFile::encodeName(fileName);
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    if (path.size() >= int(sizeof(sa->sun_path)))
+        return false;
+    memcpy(sa->sun_path, path.constData(), path.size());
+    return true;
+}
+#endif
+
+// A socket left behind at the path is replaced, anything else there is left
+// alone; and the socket is removed again once done with.
+void tst_tuio::unixDatagrams()
+{
+#if !defined(Q_OS_UNIX)
+    QSKIP("Unix sockets are only supported on Unix");
+#else
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QStringLiteral("/tuio");
+    sockaddr_un sa;
+    QVERIFY(unixSocketAddress(path, &sa));
+
+    // as if an earlier run had crashed
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    QVERIFY(fd >= 0);
+    QCOMPARE(::bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)), 0);
+    ::close(fd);
+    QVERIFY(QFile::exists(path));
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("unix=") + path);
+
+    fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    QVERIFY(fd >= 0);
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.25f));
+    QByteArray frame = tuioFrame(cursors, 1);
+    QCOMPARE(::sendto(fd, frame.constData(), frame.size(), 0, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)), ssize_t(frame.size()));
+    QVERIFY(waitForEvents(1));
+    frame = tuioFrame(QVector<Cursor>(), 2);
+    QCOMPARE(::sendto(fd, frame.constData(), frame.size(), 0, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)), ssize_t(frame.size()));
+    QVERIFY(waitForEvents(2));
+    ::close(fd);
+
+    QCOMPARE(m_window->events.at(0).type, QEvent::TouchBegin);
+    QVERIFY(qAbs(m_window->events.at(0).points.at(0).pos().y() - 100) < 1);
+    QCOMPARE(m_window->events.at(1).type, QEvent::TouchEnd);
+
+    // a second one can't take it over while it's in use
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Failed to bind TUIO socket"));
+    QTuioHandler *second = new QTuioHandler(QStringLiteral("unix=") + path);
+    delete second;
+    QVERIFY(QFile::exists(path));
+
+    delete m_handler;
+    m_handler = 0;
+    QVERIFY(!QFile::exists(path));
+
+    // nor is a file that isn't a socket replaced
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("precious");
+    file.close();
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Failed to bind TUIO socket"));
+    m_handler = new QTuioHandler(QStringLiteral("unix=") + path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("precious"));
+#endif
+}
+
+void tst_tuio::shmWrapOverrun()
+{
+#if !defined(Q_OS_LINUX)
+    QSKIP("Shared memory is only supported on Linux");
+#else
+    // set the segment up as the tracker would
+    const QByteArray name = "/qtuiotest-" + QByteArray::number(QCoreApplication::applicationPid());
+    const quint32 capacity = 4096;
+    const size_t size = sizeof(QTuioShmHeader) + capacity;
+    const int fd = ::shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    QVERIFY(fd >= 0);
+    QCOMPARE(::ftruncate(fd, size), 0);
+    void *memory = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    QVERIFY(memory != MAP_FAILED);
+    QTuioShmHeader *header = static_cast<QTuioShmHeader *>(memory);
+    char *ring = static_cast<char *>(memory) + sizeof(QTuioShmHeader);
+    header->version = QTuioShmVersion;
+    header->capacity = capacity;
+    header->magic = QTuioShmMagic;
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("shm=") + QString::fromLatin1(name));
+
+    // wait for the reader to have caught up with (no) records
+    QElapsedTimer timer;
+    timer.start();
+    while (!header->readerWaiting.loadAcquire() && timer.elapsed() < 2000)
+        QTest::qWait(10);
+    QVERIFY(header->readerWaiting.loadAcquire());
+
+    // a wrap marker skipping the whole ring, having written 8 bytes of it
+    const quint32 wrap = QTuioShmWrap;
+    memcpy(ring, &wrap, sizeof(wrap));
+    header->writePosition.storeRelease(8);
+    header->sequence.fetchAndAddOrdered(1);
+
+    timer.restart();
+    while (m_handler->stats().rejectedMalformed.load() == 0 && timer.elapsed() < 2000)
+        QTest::qWait(10);
+    QCOMPARE(m_handler->stats().rejectedMalformed.load(), 1);
+    QCOMPARE(header->readPosition.loadAcquire(), quint64(8));
+
+    // and then a real one
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.5f));
+    const QByteArray frame = tuioFrame(cursors, 1);
+    const quint32 frameSize = frame.size();
+    memcpy(ring + 8, &frameSize, sizeof(frameSize));
+    memcpy(ring + 12, frame.constData(), frame.size());
+    header->writePosition.storeRelease(12 + ((frameSize + 3) & ~3u));
+    header->sequence.fetchAndAddOrdered(1);
+
+    QVERIFY(waitForEvents(1));
+    QCOMPARE(m_window->events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(m_handler->stats().rejectedMalformed.load(), 1);
+
+    delete m_handler; // stops the reader before the memory goes away
+    m_handler = 0;
+    ::munmap(memory, size);
+    ::shm_unlink(name.constData());
+#endif
+}
+
+// The allow-list is matched against the raw addresses the kernel hands us.
+void tst_tuio::senderFilter()
+{
+    QTuioPacketFilter filter;
+    QVERIFY(filter.isAllowed(QTuioSenderAddress::fromIPv4(0x0a000105, 3333))); // anyone, without a list
+
+    QVERIFY(filter.addAllowedSender("10.0.1.0/24"));
+    QVERIFY(filter.addAllowedSender("fd00:1::/32"));
+    QVERIFY(filter.addAllowedSender("fe80::1"));
+    QVERIFY(!filter.addAllowedSender("nonsense"));
+
+    QVERIFY(filter.isAllowed(QTuioSenderAddress::fromIPv4(0x0a000105, 3333)));  // 10.0.1.5
+    QVERIFY(!filter.isAllowed(QTuioSenderAddress::fromIPv4(0x0a000205, 3333))); // 10.0.2.5
+    QVERIFY(filter.isAllowed(QTuioSenderAddress::fromHostAddress(QHostAddress("fd00:1:2::3"), 3333)));
+    QVERIFY(!filter.isAllowed(QTuioSenderAddress::fromHostAddress(QHostAddress("fd00:2::3"), 3333)));
+    QVERIFY(filter.isAllowed(QTuioSenderAddress::fromHostAddress(QHostAddress("fe80::1"), 3333)));
+    QVERIFY(!filter.isAllowed(QTuioSenderAddress::fromHostAddress(QHostAddress("fe80::2"), 3333)));
+
+    // IPv4 senders on an IPv6 socket, and back
+    const QTuioSenderAddress mapped = QTuioSenderAddress::fromHostAddress(QHostAddress("::ffff:10.0.1.5"), 3333);
+    QVERIFY(mapped.isIPv4());
+    QVERIFY(filter.isAllowed(mapped));
+    QCOMPARE(mapped.toHostAddress(), QHostAddress("10.0.1.5"));
+    QVERIFY(mapped == QTuioSenderAddress::fromIPv4(0x0a000105, 3333));
+    QVERIFY(!(mapped == QTuioSenderAddress::fromIPv4(0x0a000105, 3334)));
+
+    // a flood of new senders doesn't make the filter forget about the ones
+    // it has just seen
+    filter.setRateLimit(1, 1);
+    for (quint64 source = 1; source < 1000; ++source)
+        QVERIFY(filter.takeToken(source));
+    QVERIFY(!filter.takeToken(999));
+    QVERIFY(!filter.takeToken(900));
+}
+
+// Ports given without an address take IPv4 and IPv6 datagrams alike.
+void tst_tuio::dualStack()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=%1").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.5f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    QUdpSocket sender6;
+    if (!sender6.bind(QHostAddress::LocalHostIPv6, 0))
+        QSKIP("IPv6 is not available");
+    const QByteArray frame = tuioFrame(QVector<Cursor>(), ++m_frameId);
+    QCOMPARE(sender6.writeDatagram(frame, QHostAddress::LocalHostIPv6, m_port), qint64(frame.size()));
+
+    // a tracker of its own, which never had that cursor
+    QTRY_COMPARE(m_handler->stats().bundles.load(), 2);
+    QCOMPARE(m_handler->stats().rejectedSender.load(), 0);
+}
+
+// With the receive buffer overflowing, the datagrams the kernel dropped are
+// counted, once the next one that made it in is read.
+void tst_tuio::kernelDrops()
+{
+#if !defined(Q_OS_LINUX)
+    QSKIP("SO_RXQ_OVFL is only supported on Linux");
+#else
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:rcvbuf=4096").arg(m_port));
+    const QTuioStats &stats = m_handler->stats();
+
+    // nothing is read without getting back to the event loop
+    const int sent = 200;
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.5f));
+    for (int i = 0; i < sent; ++i)
+        sendFrame(cursors);
+
+    QTRY_VERIFY(stats.datagrams.load() > 0);
+    QTest::qWait(50);
+    QVERIFY(stats.datagrams.load() < sent);
+    QCOMPARE(stats.kernelDrops.load(), 0);
+
+    sendFrame(cursors);
+    QTRY_COMPARE(stats.datagrams.load() + stats.kernelDrops.load(), sent + 1);
+#endif
+}
+
+// A datagram that waited in the socket while the GUI thread was busy makes for
+// a touch event stamped with the time it arrived, not the time it was read.
+void tst_tuio::kernelTimestamps()
+{
+#if !defined(Q_OS_LINUX)
+    QSKIP("SO_TIMESTAMPNS is only supported on Linux");
+#else
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.5f));
+    const qint64 sent = QWindowSystemInterfacePrivate::eventTime.elapsed();
+    sendFrame(cursors);
+    QTest::qSleep(200);
+    QVERIFY(waitForEvents(1));
+
+    const qint64 eventTime = m_window->events.at(0).eventTime;
+    QVERIFY2(eventTime >= sent - 1 && eventTime < sent + 100,
+             qPrintable(QStringLiteral("sent at %1 ms, stamped %2 ms").arg(sent).arg(eventTime)));
+    QVERIFY(m_handler->stats().dispatchLatency.load() >= 200000);
+#endif
+}
+
+// A burst from one sender is cut off at its rate limit, and garbage is dropped
+// (and counted) before it gets that far.
+void tst_tuio::rateLimit()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:ratelimit=1,3").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.5f));
+    for (int i = 0; i < 10; ++i) {
+        sendFrame(cursors);
+        cursors[0].x += 0.05f;
+    }
+
+    // not a bundle at all, and one with an element larger than itself
+    const QByteArray garbage("nonsense");
+    QCOMPARE(m_sender.writeDatagram(garbage, QHostAddress::LocalHost, m_port), qint64(garbage.size()));
+    QByteArray oversized = tuioFrame(cursors, ++m_frameId);
+    qToBigEndian<quint32>(oversized.size(), reinterpret_cast<uchar *>(oversized.data()) + 16);
+    QCOMPARE(m_sender.writeDatagram(oversized, QHostAddress::LocalHost, m_port), qint64(oversized.size()));
+
+    const QTuioStats &stats = m_handler->stats();
+    QTRY_COMPARE(stats.datagrams.load(), 12);
+    QCOMPARE(stats.rejectedMalformed.load(), 2);
+    QCOMPARE(stats.rejectedRate.load(), 7);
+    QCOMPARE(stats.rejectedSender.load(), 0);
+    QCOMPARE(stats.bundles.load(), 3);
+
+    QVERIFY(waitForEvents(3));
+    QTest::qWait(50);
+    QCOMPARE(m_window->events.size(), 3);
+}
+
+void tst_tuio::mapFunctions_data()
+{
+    QTest::addColumn<int>("rotation");
+    QTest::addColumn<bool>("invertx");
+    QTest::addColumn<bool>("inverty");
+
+    for (int rotation = 0; rotation < 360; rotation += 90) {
+        for (int invert = 0; invert < 4; ++invert) {
+            QTest::newRow(qPrintable(QStringLiteral("rotate=%1%2%3").arg(rotation)
+                                     .arg(QLatin1String(invert & 1 ? ":invertx" : ""))
+                                     .arg(QLatin1String(invert & 2 ? ":inverty" : ""))))
+                << rotation << bool(invert & 1) << bool(invert & 2);
+        }
+    }
+}
+
+// Each of the specialized versions must map just like the transform the
+// handler would otherwise build for the same options.
+void tst_tuio::mapFunctions()
+{
+    QFETCH(int, rotation);
+    QFETCH(bool, invertx);
+    QFETCH(bool, inverty);
+
+    QTransform transform;
+    if (rotation)
+        transform = QTransform::fromTranslate(0.5, 0.5).rotate(rotation).translate(-0.5, -0.5);
+    if (invertx)
+        transform *= QTransform::fromTranslate(0.5, 0.5).scale(-1.0, 1.0).translate(-0.5, -0.5);
+    if (inverty)
+        transform *= QTransform::fromTranslate(0.5, 0.5).scale(1.0, -1.0).translate(-0.5, -0.5);
+
+    QPointF points[] = { QPointF(0, 0), QPointF(1, 0), QPointF(0, 1), QPointF(1, 1),
+                         QPointF(0.5, 0.5), QPointF(0.25, 0.125), QPointF(0.9, 0.3) };
+    const int count = sizeof(points) / sizeof(points[0]);
+    QPointF expected[count];
+    for (int i = 0; i < count; ++i)
+        expected[i] = transform.map(points[i]);
+
+    qt_tuioMapFunction(rotation, invertx, inverty)(QTransform(), points, count);
+
+    for (int i = 0; i < count; ++i) {
+        QVERIFY2(qAbs(points[i].x() - expected[i].x()) < 1e-9 && qAbs(points[i].y() - expected[i].y()) < 1e-9,
+                 qPrintable(QStringLiteral("point %1 mapped to %2,%3 rather than %4,%5").arg(i)
+                            .arg(points[i].x()).arg(points[i].y()).arg(expected[i].x()).arg(expected[i].y())));
+    }
+}
+
+// Two trackers using the same cursor IDs are forwarded as one: every frame
+// covers the touches of both, with IDs of their own. Forwarding to a port we
+// listen on ourselves is refused.
+void tst_tuio::forwardMerged()
+{
+    QUdpSocket receiver;
+    QVERIFY(receiver.bind(QHostAddress::LocalHost, 0));
+
+    delete m_handler;
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Ignoring TUIO forwarding destination"));
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:forwardmapped=%2,%1").arg(m_port).arg(receiver.localPort()));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.25f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    QUdpSocket other;
+    const QByteArray frame = tuioFrame(cursors, 1);
+    QCOMPARE(other.writeDatagram(frame, QHostAddress::LocalHost, m_port), qint64(frame.size()));
+    QVERIFY(waitForEvents(2));
+
+    // one frame forwarded per frame delivered, the last one covering both
+    QByteArray forwarded;
+    int count = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (count < 2 && timer.elapsed() < 2000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents);
+        while (receiver.hasPendingDatagrams()) {
+            forwarded.resize(int(receiver.pendingDatagramSize()));
+            receiver.readDatagram(forwarded.data(), forwarded.size());
+            ++count;
+        }
+    }
+    QCOMPARE(count, 2);
+
+    const QList<QOscMessage> messages = QOscBundle(forwarded).messages();
+    QCOMPARE(messages.size(), 4); // alive, a set per cursor, fseq
+    QCOMPARE(messages.at(0).stringAt(0), QByteArray("alive"));
+    QCOMPARE(messages.at(0).argumentCount(), 3);
+    QVERIFY(messages.at(0).int32At(1) != messages.at(0).int32At(2));
+    QCOMPARE(messages.at(3).stringAt(0), QByteArray("fseq"));
+    QCOMPARE(messages.at(3).int32At(1), 2);
+}
+
+// Frames arriving in one go are delivered as one event with the immediate
+// option, and that event has been handled by the time the event loop returns.
+void tst_tuio::immediateMerge()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:immediate").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.25f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    for (int i = 0; i < 3; ++i) {
+        cursors[0].x += 0.1f;
+        sendFrame(cursors);
+    }
+    QVERIFY(waitForEvents(2));
+    QTest::qWait(50);
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 2);
+    QCOMPARE(events.at(1).type, QEvent::TouchUpdate);
+    QCOMPARE(events.at(1).points.size(), 1);
+    QCOMPARE(events.at(1).points.at(0).state(), Qt::TouchPointMoved);
+    QVERIFY(qAbs(events.at(1).points.at(0).pos().x() - 220) < 1);
+    QCOMPARE(m_handler->stats().droppedFrames.load(), 2);
+    QVERIFY(m_handler->stats().maxDeliveryLatency.load() > 0);
+
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(3));
+    QCOMPARE(events.at(2).type, QEvent::TouchEnd);
+}
+
+// While the GUI thread is behind, frames are held back, and merged: a press,
+// moves and a release make for one catch-up press where the touch was last,
+// and its release. A frame held for a window that is gone by then is dropped.
+void tst_tuio::backpressure()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:backpressure=8").arg(m_port));
+    QVERIFY(connect(this, SIGNAL(bundleReceived(quint64,QOscBundle,QTuioPacketTimes)),
+                    m_handler, SLOT(processBundle(quint64,QOscBundle,QTuioPacketTimes))));
+    const QTuioStats &stats = m_handler->stats();
+
+    stall(m_window, 16);
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.5f));
+    for (int i = 0; i < 4; ++i) {
+        receiveFrame(cursors);
+        cursors[0].x += 0.1f;
+    }
+    receiveFrame(QVector<Cursor>());
+
+    // nothing was handed to Qt yet
+    QCOMPARE(QWindowSystemInterface::windowSystemEventsQueued(), 16);
+    QCOMPARE(stats.droppedFrames.load(), 3);
+    QCOMPARE(stats.maxQueueDepth.load(), 16);
+
+    QVERIFY(waitForEvents(2));
+    QTest::qWait(50);
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 2);
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 1);
+    QCOMPARE(events.at(0).points.at(0).state(), Qt::TouchPointPressed);
+    QVERIFY(qAbs(events.at(0).points.at(0).pos().x() - 220) < 1);
+    QCOMPARE(events.at(1).type, QEvent::TouchEnd);
+    QVERIFY(qAbs(events.at(1).points.at(0).pos().x() - 220) < 1);
+
+    // the window goes away while its frame is held back
+    TouchWindow *other = new TouchWindow;
+    other->setGeometry(0, 0, 400, 400);
+    other->show();
+    other->requestActivate();
+    QVERIFY(QTest::qWaitForWindowActive(other));
+
+    stall(other, 16);
+    cursors[0].id = 2;
+    receiveFrame(cursors);
+    receiveFrame(QVector<Cursor>());
+    delete other;
+    QTRY_COMPARE(QWindowSystemInterface::windowSystemEventsQueued(), 0);
+    QTest::qWait(50);
+
+    // and everything carries on as before
+    m_window->requestActivate();
+    QVERIFY(QTest::qWaitForWindowActive(m_window));
+    cursors[0].id = 3;
+    receiveFrame(cursors);
+    QVERIFY(waitForEvents(3));
+    QCOMPARE(events.at(2).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(2).points.size(), 1);
+}
+
+// The trace is valid JSON, with a track per stage, and covers every frame up
+// to its delivery, also those that were held back for a while.
+void tst_tuio::trace()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.path() + QStringLiteral("/trace.json");
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:backpressure=8:trace=%2").arg(m_port).arg(fileName));
+    QVERIFY(connect(this, SIGNAL(bundleReceived(quint64,QOscBundle,QTuioPacketTimes)),
+                    m_handler, SLOT(processBundle(quint64,QOscBundle,QTuioPacketTimes))));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.5f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    // held back for at least 50ms
+    stall(m_window, 16);
+    cursors[0].x = 0.5f;
+    receiveFrame(cursors);
+    receiveFrame(QVector<Cursor>());
+    QTest::qSleep(50);
+    QVERIFY(waitForEvents(2));
+
+    QVERIFY(m_handler->writeTrace());
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    const QJsonArray traceEvents = document.object().value(QStringLiteral("traceEvents")).toArray();
+    int threadNames = 0;
+    QMap<int, QJsonObject> frames; // by frame ID
+    QMap<int, QJsonObject> dispatches;
+    foreach (const QJsonValue &value, traceEvents) {
+        const QJsonObject event = value.toObject();
+        const QString name = event.value(QStringLiteral("name")).toString();
+        if (event.value(QStringLiteral("ph")).toString() == QLatin1String("M")) {
+            QCOMPARE(name, QStringLiteral("thread_name"));
+            ++threadNames;
+            continue;
+        }
+
+        QCOMPARE(event.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+        QCOMPARE(event.value(QStringLiteral("pid")).toInt(), int(QCoreApplication::applicationPid()));
+        QVERIFY(event.value(QStringLiteral("ts")).toDouble() > 0);
+        QVERIFY(event.value(QStringLiteral("dur")).toDouble() >= 0);
+        const int frameId = event.value(QStringLiteral("args")).toObject().value(QStringLiteral("frame")).toInt();
+        if (name == QLatin1String("frame"))
+            frames.insert(frameId, event);
+        else if (name == QLatin1String("dispatch"))
+            dispatches.insert(frameId, event);
+    }
+
+    QCOMPARE(threadNames, 3);
+    QCOMPARE(frames.keys(), QList<int>() << 1 << 2 << 3);
+    QCOMPARE(dispatches.keys(), QList<int>() << 1 << 2 << 3);
+    QCOMPARE(frames.value(1).value(QStringLiteral("args")).toObject().value(QStringLiteral("cursors")).toInt(), 1);
+    QCOMPARE(frames.value(1).value(QStringLiteral("tid")).toInt(), 3);
+    QCOMPARE(dispatches.value(1).value(QStringLiteral("tid")).toInt(), 2);
+    for (int frameId = 2; frameId <= 3; ++frameId)
+        QVERIFY(dispatches.value(frameId).value(QStringLiteral("dur")).toDouble() >= 50000);
+}
+
+// Reads the snapshot from another thread, like a render thread would.
+class SnapshotReader : public QThread
+{
+public:
+    SnapshotReader(const QTuioSnapshotBuffer *buffer) : buffer(buffer) {}
+
+    const QTuioSnapshotBuffer *buffer;
+    QTuioSnapshot snapshot;
+
+protected:
+    void run()
+    {
+        buffer->read(&snapshot);
+    }
+};
+
+void tst_tuio::snapshot()
+{
+    QVERIFY(!qt_tuioSnapshotBuffer());
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:snapshot:invertx").arg(m_port));
+    const QTuioSnapshotBuffer *buffer = qt_tuioSnapshotBuffer();
+    QVERIFY(buffer);
+
+    QTuioSnapshot snapshot;
+    buffer->read(&snapshot);
+    QCOMPARE(snapshot.count, 0);
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(3, 0.25f, 0.5f));
+    cursors.append(Cursor(4, 0.5f, 0.75f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    SnapshotReader reader(buffer);
+    reader.start();
+    QVERIFY(reader.wait(2000));
+    QVERIFY(reader.snapshot.frame != snapshot.frame);
+    QCOMPARE(reader.snapshot.count, 2);
+    QCOMPARE(reader.snapshot.points[0].id, 3);
+    QCOMPARE(reader.snapshot.points[0].source, 0);
+    QCOMPARE(reader.snapshot.points[0].x, 0.75f);
+    QCOMPARE(reader.snapshot.points[0].y, 0.5f);
+    QCOMPARE(reader.snapshot.points[1].id, 4);
+    QCOMPARE(reader.snapshot.points[1].x, 0.5f);
+    QElapsedTimer now;
+    now.start();
+    QVERIFY(qAbs(reader.snapshot.timestamp - now.msecsSinceReference()) < 1000);
+
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(2));
+    buffer->read(&snapshot);
+    QCOMPARE(snapshot.count, 0);
+
+    delete m_handler;
+    m_handler = 0;
+    QVERIFY(!qt_tuioSnapshotBuffer());
+}
+
+void tst_tuio::calibrationMesh()
+{
+    // a keystoned image: the top edge is reported narrower than the bottom
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.path() + QStringLiteral("/grid.txt"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("# keystone\n"
+               "2 2\n"
+               "0.2 0.1  0.8 0.1\n"
+               "0.1 0.9  0.9 0.9\n");
+    file.close();
+
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:calibration=%2").arg(m_port).arg(file.fileName()));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.15f, 0.5f)); // the middle of the left edge
+    cursors.append(Cursor(2, 0.5f, 0.5f));
+    cursors.append(Cursor(3, 0.8f, 0.1f));  // top right corner
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    const QList<QTouchEvent::TouchPoint> &points = m_window->events.at(0).points;
+    QCOMPARE(points.size(), 3);
+    QVERIFY(qAbs(points.at(0).pos().x() - 0) < 1);
+    QVERIFY(qAbs(points.at(0).pos().y() - 200) < 1);
+    QVERIFY(qAbs(points.at(1).pos().x() - 200) < 1);
+    QVERIFY(qAbs(points.at(1).pos().y() - 200) < 1);
+    QVERIFY(qAbs(points.at(2).pos().x() - 400) < 1);
+    QVERIFY(qAbs(points.at(2).pos().y() - 0) < 1);
+}
+
+// With hover=, depth cursors high above the surface aren't delivered, and
+// lower ones touch with a pressure depending on their height.
+void tst_tuio::hover()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:hover=0.1").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.5f, 0.5f, 0.5f));
+    QByteArray frame = tuioFrame(cursors, 1, "/tuio/25Dcur");
+    m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port);
+
+    cursors[0].z = 0.05f; // coming down
+    frame = tuioFrame(cursors, 2, "/tuio/25Dcur");
+    m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port);
+    QVERIFY(waitForEvents(1));
+
+    cursors[0].z = 0.5f; // and up again
+    frame = tuioFrame(cursors, 3, "/tuio/25Dcur");
+    m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port);
+    QVERIFY(waitForEvents(2));
+
+    // going away while hovering, then a 2D cursor
+    frame = tuioFrame(QVector<Cursor>(), 4, "/tuio/25Dcur");
+    m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port);
+    QVector<Cursor> flatCursors;
+    flatCursors.append(Cursor(2, 0.25f, 0.25f));
+    sendFrame(flatCursors);
+    QVERIFY(waitForEvents(3));
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 3);
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 1);
+    QCOMPARE(events.at(0).points.at(0).state(), Qt::TouchPointPressed);
+    QVERIFY(qAbs(events.at(0).points.at(0).pressure() - 0.5) < 0.01);
+    QCOMPARE(events.at(1).type, QEvent::TouchEnd);
+    QCOMPARE(events.at(1).points.at(0).state(), Qt::TouchPointReleased);
+    QCOMPARE(events.at(2).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(2).points.size(), 1);
+    QCOMPARE(events.at(2).points.at(0).pressure(), qreal(1));
+}
+
+// Position, height and velocity are each read from their own place in 3Dcur
+// and 3Dobj SETs (the latter having a class ID and angles in between).
+void tst_tuio::depthProfiles()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:hover=0.1").arg(m_port));
+
+    // 3Dcur: x y z X Y Z m
+    QVector<float> values;
+    values << 0.25f << 0.5f << 0.05f << 0.5f << 0.25f << 9 << 0;
+    QByteArray frame = tuioDepthFrame("/tuio/3Dcur", 1, values, 1);
+    QCOMPARE(m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port), qint64(frame.size()));
+    QVERIFY(waitForEvents(1));
+    frame = tuioFrame(QVector<Cursor>(), 2, "/tuio/3Dcur");
+    QCOMPARE(m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port), qint64(frame.size()));
+    QVERIFY(waitForEvents(2));
+
+    // 3Dobj: x y z a b c X Y Z A B C m r
+    values.clear();
+    values << 0.75f << 0.25f << 0.025f << 9 << 9 << 9 << -0.5f << 0 << 9 << 9 << 9 << 9 << 0 << 0;
+    frame = tuioDepthFrame("/tuio/3Dobj", 2, values, 3);
+    QCOMPARE(m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port), qint64(frame.size()));
+    QVERIFY(waitForEvents(3));
+    frame = tuioFrame(QVector<Cursor>(), 4, "/tuio/3Dobj");
+    QCOMPARE(m_sender.writeDatagram(frame, QHostAddress::LocalHost, m_port), qint64(frame.size()));
+    QVERIFY(waitForEvents(4));
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 4);
+
+    QCOMPARE(events.at(0).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(0).points.size(), 1);
+    const QTouchEvent::TouchPoint &cursor = events.at(0).points.at(0);
+    QVERIFY(qAbs(cursor.pos().x() - 100) < 1);
+    QVERIFY(qAbs(cursor.pos().y() - 200) < 1);
+    QVERIFY(qAbs(cursor.pressure() - 0.5) < 0.01);
+    QVERIFY(qAbs(cursor.velocity().x() - 200) < 1);
+    QVERIFY(qAbs(cursor.velocity().y() - 100) < 1);
+    QCOMPARE(events.at(1).type, QEvent::TouchEnd);
+
+    QCOMPARE(events.at(2).type, QEvent::TouchBegin);
+    QCOMPARE(events.at(2).points.size(), 1);
+    const QTouchEvent::TouchPoint &object = events.at(2).points.at(0);
+    QVERIFY(qAbs(object.pos().x() - 300) < 1);
+    QVERIFY(qAbs(object.pos().y() - 100) < 1);
+    QVERIFY(qAbs(object.pressure() - 0.75) < 0.01);
+    QVERIFY(qAbs(object.velocity().x() - -200) < 1);
+    QVERIFY(qAbs(object.velocity().y()) < 1);
+    QCOMPARE(events.at(3).type, QEvent::TouchEnd);
+}
+
+// With kinematics, a tracker sending zero velocities still makes for moving
+// touch points with a velocity (derived from their last few positions).
+void tst_tuio::kinematics()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:kinematics").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.5f));
+    for (int i = 0; i < 6; ++i) {
+        sendFrame(cursors);
+        QVERIFY(waitForEvents(i + 1));
+        QTest::qWait(10);
+        cursors[0].x += 0.05f;
+    }
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QCOMPARE(events.size(), 6);
+    QCOMPARE(events.at(0).points.at(0).velocity(), QVector2D());
+
+    // to the right, 20px per frame, frames a little over 10ms apart
+    const QVector2D velocity = events.last().points.at(0).velocity();
+    QVERIFY(velocity.x() > 100);
+    QVERIFY(qAbs(velocity.y()) < velocity.x() / 100);
+}
+
+// With smoothing, a finger at rest stays put, and a jump is smoothed: the
+// touch catches up over a few frames, and then stays put again.
+void tst_tuio::smoothing()
+{
+    delete m_handler;
+    m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:smooth").arg(m_port));
+
+    QVector<Cursor> cursors;
+    cursors.append(Cursor(1, 0.25f, 0.5f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    for (int i = 0; i < 5; ++i) {
+        QTest::qWait(20);
+        sendFrame(cursors);
+    }
+    QTest::qWait(50);
+    QCOMPARE(m_window->events.size(), 1);
+
+    // frames 20ms apart, until ten in a row didn't deliver anything
+    cursors[0].x = 0.75f;
+    int quiet = 0;
+    for (int i = 0; i < 200 && quiet < 10; ++i) {
+        const int before = m_window->events.size();
+        sendFrame(cursors);
+        QTest::qWait(20);
+        quiet = m_window->events.size() == before ? quiet + 1 : 0;
+    }
+    QCOMPARE(quiet, 10);
+
+    const QVector<TouchRecord> &events = m_window->events;
+    QVERIFY(events.size() > 3);
+    QCOMPARE(events.at(1).points.at(0).state(), Qt::TouchPointMoved);
+    QVERIFY(events.at(1).points.at(0).pos().x() > 100);
+    QVERIFY(events.at(1).points.at(0).pos().x() < 290);
+    QVERIFY(events.at(2).points.at(0).pos().x() > events.at(1).points.at(0).pos().x());
+    QVERIFY(qAbs(events.last().points.at(0).pos().x() - 300) < 0.1);
+}
+
+void tst_tuio::latency_data()
+{
+    QTest::addColumn<int>("cursorCount");
+    QTest::addColumn<bool>("immediate");
+
+    QTest::newRow("1 cursor") << 1 << false;
+    QTest::newRow("10 cursors") << 10 << false;
+    QTest::newRow("40 cursors") << 40 << false;
+    QTest::newRow("1 cursor, immediate") << 1 << true;
+    QTest::newRow("40 cursors, immediate") << 40 << true;
+}
+
+// Measures the time from a frame being sent to its touch event arriving at the
+// window. The 99th percentile must stay below QTUIO_LATENCY_BUDGET
+// milliseconds (by default, 20).
+void tst_tuio::latency()
+{
+    QFETCH(int, cursorCount);
+    QFETCH(bool, immediate);
+    const int frames = 500;
+
+    if (immediate) {
+        delete m_handler;
+        m_handler = new QTuioHandler(QStringLiteral("udp=127.0.0.1@%1:immediate").arg(m_port));
+    }
+
+    QVector<Cursor> cursors;
+    for (int i = 0; i < cursorCount; ++i)
+        cursors.append(Cursor(i + 1, (i + 1) / qreal(cursorCount + 2), 0.5f));
+    sendFrame(cursors);
+    QVERIFY(waitForEvents(1));
+
+    QVector<qint64> latencies;
+    latencies.reserve(frames);
+    for (int i = 0; i < frames; ++i) {
+        for (int j = 0; j < cursors.size(); ++j)
+            cursors[j].y = 0.25f + (i % 100) / 200.0f;
+
+        const qint64 sent = qt_tuioTimestamp();
+        sendFrame(cursors);
+        QVERIFY(waitForEvents(i + 2));
+        QCOMPARE(m_window->events.last().points.size(), cursorCount);
+        latencies.append(m_window->events.last().timestamp - sent);
+    }
+
+    sendFrame(QVector<Cursor>());
+    QVERIFY(waitForEvents(frames + 2));
+    QCOMPARE(m_window->events.last().type, QEvent::TouchEnd);
+
+    std::sort(latencies.begin(), latencies.end());
+    const qint64 p50 = latencies.at(frames / 2);
+    const qint64 p90 = latencies.at(frames * 9 / 10);
+    const qint64 p99 = latencies.at(frames * 99 / 100);
+    qDebug("%d cursors%s: latency p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms", cursorCount,
+           immediate ? " (immediate)" : "", p50 / 1e6, p90 / 1e6, p99 / 1e6, latencies.last() / 1e6);
+
+    bool ok = false;
+    int budget = qgetenv("QTUIO_LATENCY_BUDGET").toInt(&ok);
+    if (!ok)
+        budget = 20;
+    QVERIFY2(p99 < budget * Q_INT64_C(1000000),
+             qPrintable(QStringLiteral("p99 latency %1 ms is over budget").arg(p99 / 1e6)));
+}
+
+int main(int argc, char **argv)
+{
+    // no display or touch hardware needed
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    tst_tuio test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "main.moc"
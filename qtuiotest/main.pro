@@ -0,0 +1,32 @@
+QT += testlib network core-private gui-private
+
+SOURCES += \
+    main.cpp \
+    ../qoscmessage.cpp \
+    ../qoscbundle.cpp \
+    ../qoscwriter.cpp \
+    ../qtuiocalibration.cpp \
+    ../qtuioforwarder.cpp \
+    ../qtuiohandler.cpp \
+    ../qtuiopacketfilter.cpp \
+    ../qtuioudptransport.cpp \
+    ../qtuiounixtransport.cpp \
+    ../qtuioshmtransport.cpp \
+    ../qtuiosliptransport.cpp \
+    ../qtuiotrace.cpp \
+    ../qtuiotransport.cpp \
+    ../qtuiowindowindex.cpp
+
+HEADERS += \
+    ../qtuiohandler_p.h \
+    ../qtuiosnapshot.h \
+    ../qtuioudptransport_p.h \
+    ../qtuioshmtransport_p.h \
+    ../qtuiosliptransport_p.h \
+    ../qtuiotransport_p.h \
+    ../qtuiounixtransport_p.h \
+    ../qtuiowindowindex_p.h
+
+CONFIG -= app_bundle
+
+linux: LIBS += -lrt
@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QLoggingCategory>
+
+#include <string.h>
+#if defined(Q_OS_LINUX)
+#include <time.h>
+#endif
+
+#include "qtuiostats_p.h"
+#include "qtuiotrace_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QTuioTrace::QTuioTrace(int capacity)
+    : m_frames(qMax(1, capacity))
+    , m_next(0)
+    , m_count(0)
+    , m_recorded(0)
+{
+}
+
+QTuioTrace::Frame &QTuioTrace::beginFrame(quint64 source, const QTuioPacketTimes &times)
+{
+    Frame &frame = m_frames[m_next];
+    m_next = (m_next + 1) % m_frames.size();
+    m_count = qMin(m_count + 1, m_frames.size());
+
+    memset(&frame, 0, sizeof(frame));
+    frame.number = ++m_recorded;
+    frame.source = source;
+    frame.frameId = -1;
+    frame.times[Received] = times.received;
+    frame.times[ParseStart] = times.parseStart;
+    frame.times[ParseEnd] = times.parseEnd;
+    return frame;
+}
+
+QTuioTrace::Frame *QTuioTrace::frame(qint64 number)
+{
+    const qint64 age = m_recorded - number; // 0 for the last one
+    if (number <= 0 || age < 0 || age >= m_count)
+        return 0;
+    return &m_frames[(m_next + m_frames.size() - 1 - int(age)) % m_frames.size()];
+}
+
+// When qt_tuioClock started, in nanoseconds on the system's monotonic clock.
+// On Linux, that is the clock QElapsedTimer reads, but it only tells its
+// reference in milliseconds; so read both clocks, at full resolution.
+static qint64 qt_tuioClockOrigin()
+{
+#if defined(Q_OS_LINUX)
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * Q_INT64_C(1000000000) + now.tv_nsec - qt_tuioTimestamp();
+#else
+    return qt_tuioClock().msecsSinceReference() * Q_INT64_C(1000000);
+#endif
+}
+
+// Nanoseconds as microseconds with three decimals, without going through a
+// double (which, this far from the clock's epoch, would lose the last ones).
+static void qt_appendMicroseconds(QByteArray &out, qint64 nsecs)
+{
+    out += QByteArray::number(nsecs / 1000);
+    out += '.';
+    const int fraction = int(nsecs % 1000);
+    if (fraction < 100)
+        out += fraction < 10 ? "00" : "0";
+    out += QByteArray::number(fraction);
+}
+
+// One complete ("X") event from start to end, both in nanoseconds on
+// qt_tuioClock. origin (see qt_tuioClockOrigin) moves them onto the monotonic
+// clock.
+static void qt_writeTraceEvent(QByteArray &out, const char *name, qint64 origin, qint64 start, qint64 end,
+                               qint64 pid, int tid, const QTuioTrace::Frame &frame)
+{
+    if (!start || !end || end < start)
+        return;
+
+    if (!out.endsWith('['))
+        out += ",\n";
+    out += "{\"name\":\"";
+    out += name;
+    out += "\",\"cat\":\"tuio\",\"ph\":\"X\",\"ts\":";
+    qt_appendMicroseconds(out, origin + start);
+    out += ",\"dur\":";
+    qt_appendMicroseconds(out, end - start);
+    out += ",\"pid\":";
+    out += QByteArray::number(pid);
+    out += ",\"tid\":";
+    out += QByteArray::number(tid);
+    out += ",\"args\":{\"source\":\"0x";
+    out += QByteArray::number(frame.source, 16);
+    out += "\",\"frame\":";
+    out += QByteArray::number(frame.frameId);
+    out += ",\"cursors\":";
+    out += QByteArray::number(frame.cursors);
+    out += "}}";
+}
+
+bool QTuioTrace::write(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to write TUIO trace to " << fileName << ": " << file.errorString();
+        return false;
+    }
+
+    const qint64 origin = qt_tuioClockOrigin();
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    // the receiving side of a frame goes on one track, the handler's on
+    // another, and the whole frame, arrival to delivery, on a third.
+    QByteArray out("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(pid)
+        + ",\"tid\":1,\"args\":{\"name\":\"TUIO receive\"}},\n";
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(pid)
+        + ",\"tid\":2,\"args\":{\"name\":\"TUIO handler\"}},\n";
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(pid)
+        + ",\"tid\":3,\"args\":{\"name\":\"TUIO frames\"}}";
+
+    for (int i = 0; i < m_count; ++i) {
+        const Frame &frame = m_frames.at((m_next - m_count + i + m_frames.size()) % m_frames.size());
+        const qint64 *t = frame.times;
+        const qint64 setStart = t[AliveEnd] ? t[AliveEnd] : t[ProcessStart];
+
+        qt_writeTraceEvent(out, "wait", origin, t[Received], t[ParseStart], pid, 1, frame);
+        qt_writeTraceEvent(out, "parse", origin, t[ParseStart], t[ParseEnd], pid, 1, frame);
+        qt_writeTraceEvent(out, "queued", origin, t[ParseEnd] ? t[ParseEnd] : t[Received], t[ProcessStart], pid, 2, frame);
+        qt_writeTraceEvent(out, "alive", origin, t[ProcessStart], t[AliveEnd], pid, 2, frame);
+        qt_writeTraceEvent(out, "set", origin, setStart, t[SetEnd], pid, 2, frame);
+        qt_writeTraceEvent(out, "dispatch", origin, t[DispatchStart], t[Delivered], pid, 2, frame);
+        qt_writeTraceEvent(out, "frame", origin, t[Received], t[Delivered] ? t[Delivered] : t[DispatchStart], pid, 3, frame);
+    }
+
+    out += "]}\n";
+
+    if (file.write(out) != out.size()) {
+        qWarning() << "Failed to write TUIO trace to " << fileName << ": " << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QT_END_NAMESPACE
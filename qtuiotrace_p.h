@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOTRACE_P_H
+#define QTUIOTRACE_P_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+// When a datagram arrived, and when the receiver started and finished parsing
+// it, see qt_tuioTimestamp. The parse times are only taken while tracing.
+struct QTuioPacketTimes
+{
+    QTuioPacketTimes() : received(0), parseStart(0), parseEnd(0) {}
+
+    qint64 received;
+    qint64 parseStart;
+    qint64 parseEnd;
+};
+
+// Records what happened to each TUIO frame, and when, so that a slow frame
+// can be told apart from the others (which the counters in QTuioStats can't
+// do). Frames go into a ring buffer allocated up front, the oldest ones being
+// overwritten once it is full, so tracing doesn't allocate while touches are
+// coming in.
+//
+// Only to be used from the handler's thread.
+class QTuioTrace
+{
+public:
+    enum Phase {
+        Received,      // the datagram arrived
+        ParseStart,    // the receiver started parsing it
+        ParseEnd,
+        ProcessStart,  // the handler got the bundle
+        AliveEnd,      // done with ALIVE
+        SetEnd,        // done with the last SET
+        DispatchStart, // FSEQ: started building and delivering touch events
+        Delivered,     // the last handleTouchEvent for the frame returned
+        PhaseCount
+    };
+
+    struct Frame {
+        qint64 number; // counting all frames ever recorded, from 1
+        quint64 source;
+        int frameId;
+        int cursors;
+        qint64 times[PhaseCount]; // 0 where a phase didn't happen
+    };
+
+    explicit QTuioTrace(int capacity);
+
+    // Starts recording a new frame, overwriting the oldest one if the buffer
+    // is full. The reference stays valid until the next call.
+    Frame &beginFrame(quint64 source, const QTuioPacketTimes &times);
+
+    // The frame with the given number, or 0 if it has been overwritten since.
+    Frame *frame(qint64 number);
+
+    // Writes all recorded frames to fileName, as Chrome trace event JSON
+    // (chrome://tracing, Perfetto). Timestamps are on the system's monotonic
+    // clock, so they line up with other traces taken from it.
+    bool write(const QString &fileName) const;
+
+private:
+    QVector<Frame> m_frames;
+    int m_next;
+    int m_count;
+    qint64 m_recorded;
+};
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QTuioPacketTimes)
+
+#endif // QTUIOTRACE_P_H
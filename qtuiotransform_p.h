@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOTRANSFORM_P_H
+#define QTUIOTRANSFORM_P_H
+
+#include <QPointF>
+#include <QTransform>
+
+QT_BEGIN_NAMESPACE
+
+// Maps a frame's worth of normalized TUIO positions in place. matrix is only
+// used by the generic version; all rotate=/invertx/inverty combinations have
+// a version of their own, which boils down to swapping and flipping.
+typedef void (*QTuioMapFunction)(const QTransform &matrix, QPointF *points, int count);
+
+// Rotation is clockwise about the center, in degrees, and applied before the
+// inversions (which is what the equivalent QTransform would do).
+template <int Rotation, bool InvertX, bool InvertY>
+inline void qt_tuioMapPoints(const QTransform &, QPointF *points, int count)
+{
+    Q_STATIC_ASSERT(Rotation == 0 || Rotation == 90 || Rotation == 180 || Rotation == 270);
+
+    for (int i = 0; i < count; ++i) {
+        const qreal x = points[i].x();
+        const qreal y = points[i].y();
+        qreal mappedX;
+        qreal mappedY;
+
+        switch (Rotation) {
+        case 90:
+            mappedX = 1 - y;
+            mappedY = x;
+            break;
+        case 180:
+            mappedX = 1 - x;
+            mappedY = 1 - y;
+            break;
+        case 270:
+            mappedX = y;
+            mappedY = 1 - x;
+            break;
+        default:
+            mappedX = x;
+            mappedY = y;
+            break;
+        }
+
+        if (InvertX)
+            mappedX = 1 - mappedX;
+        if (InvertY)
+            mappedY = 1 - mappedY;
+
+        points[i].setX(mappedX);
+        points[i].setY(mappedY);
+    }
+}
+
+inline void qt_tuioMapPointsGeneric(const QTransform &matrix, QPointF *points, int count)
+{
+    for (int i = 0; i < count; ++i)
+        points[i] = matrix.map(points[i]);
+}
+
+inline QTuioMapFunction qt_tuioMapFunction(int rotation, bool invertx, bool inverty)
+{
+    static const QTuioMapFunction functions[4][2][2] = {
+        { { qt_tuioMapPoints<0, false, false>,   qt_tuioMapPoints<0, false, true> },
+          { qt_tuioMapPoints<0, true, false>,    qt_tuioMapPoints<0, true, true> } },
+        { { qt_tuioMapPoints<90, false, false>,  qt_tuioMapPoints<90, false, true> },
+          { qt_tuioMapPoints<90, true, false>,   qt_tuioMapPoints<90, true, true> } },
+        { { qt_tuioMapPoints<180, false, false>, qt_tuioMapPoints<180, false, true> },
+          { qt_tuioMapPoints<180, true, false>,  qt_tuioMapPoints<180, true, true> } },
+        { { qt_tuioMapPoints<270, false, false>, qt_tuioMapPoints<270, false, true> },
+          { qt_tuioMapPoints<270, true, false>,  qt_tuioMapPoints<270, true, true> } }
+    };
+
+    Q_ASSERT(rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270);
+    return functions[rotation / 90][invertx][inverty];
+}
+
+QT_END_NAMESPACE
+
+#endif // QTUIOTRANSFORM_P_H
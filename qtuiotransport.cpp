@@ -0,0 +1,108 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qtuiotransport_p.h"
+#include "qoscbundle_p.h"
+#include "qtuiostats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+static QBasicAtomicInt qt_tuioTransportCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+QTuioTransport::QTuioTransport(const QTuioPacketFilter &filter, QTuioStats *stats)
+    : m_stats(stats)
+    , m_id(qt_tuioTransportCount.fetchAndAddRelaxed(1) + 1)
+    , m_sourceCount(0)
+    , m_filter(filter)
+    , m_tracing(false)
+{
+}
+
+char *QTuioTransport::packetBuffer()
+{
+    if (m_buffer.isEmpty())
+        m_buffer.resize(qt_tuioMaxPacketSize);
+    return m_buffer.data();
+}
+
+bool QTuioTransport::screenPacket(const char *data, qint64 size, const QTuioSenderAddress *sender)
+{
+    qt_tuioCount(m_stats->datagrams);
+
+    // get rid of anything we don't want as cheaply as possible, before
+    // spending any time on parsing it.
+    if (sender && !m_filter.isAllowed(*sender)) {
+        qt_tuioCount(m_stats->rejectedSender);
+        return false;
+    }
+
+    if (!QTuioPacketFilter::looksLikeBundle(data, size)) {
+        qt_tuioCount(m_stats->rejectedMalformed);
+        return false;
+    }
+
+    return true;
+}
+
+void QTuioTransport::parsePacket(const char *data, qint64 size, quint64 source, qint64 timestamp)
+{
+    if (!m_filter.takeToken(source)) {
+        qt_tuioCount(m_stats->rejectedRate);
+        return;
+    }
+
+    // relay before parsing, so the relay doesn't wait on us
+    m_forwarder.forward(data, size);
+
+    QTuioPacketTimes times;
+    times.received = timestamp;
+    if (m_tracing)
+        times.parseStart = qt_tuioTimestamp();
+
+    // parsed where it is; the bundle keeps one copy of the borrowed packet, and
+    // its messages point into that.
+    QOscBundle bundle(QByteArray::fromRawData(data, size));
+    if (!bundle.isValid()) {
+        qt_tuioCount(m_stats->invalidBundles);
+        return;
+    }
+
+    if (m_tracing)
+        times.parseEnd = qt_tuioTimestamp();
+
+    qt_tuioCount(m_stats->bundles);
+    emit bundleReceived(source, bundle, times);
+}
+
+QT_END_NAMESPACE
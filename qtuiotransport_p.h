@@ -0,0 +1,144 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOTRANSPORT_P_H
+#define QTUIOTRANSPORT_P_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+#include "qtuioforwarder_p.h"
+#include "qtuiopacketfilter_p.h"
+#include "qtuiotrace_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QOscBundle;
+struct QTuioStats;
+
+// Large enough for any UDP datagram, and so any TUIO packet.
+static const int qt_tuioMaxPacketSize = 65536;
+
+// How long (in nanoseconds) a source may send nothing before it is forgotten:
+// its touches are released, and a sender coming back after that is a new
+// source. Trackers keep sending ALIVE and FSEQ while idle, so only those that
+// went away (or were never more than a stray packet) go quiet for this long.
+static const qint64 qt_tuioSourceTimeout = Q_INT64_C(10000000000);
+
+// Something TUIO packets come in through: a UDP socket, shared memory, a Unix
+// socket or a pipe. A transport reads raw OSC packets, and hands each to
+// processPacket, which filters, forwards and parses it, and passes the
+// bundle on to the QTuioHandler.
+//
+// All transports share one rule for their buffers: a packet is read into
+// memory the transport keeps for good (packetBuffer(), allocated once when
+// the transport starts, or for shared memory, the ring itself), and it is
+// parsed right there, and processPacket doesn't hold on to the data once it
+// returns. Up to parsing, a packet from a known sender costs no allocations,
+// with one exception: where UDP goes through QUdpSocket (not on Unix, where
+// the sender is taken from the raw sockaddr), the sender is handed to us as a
+// QHostAddress, which allocates for every datagram.
+//
+// A transport may be moved to a worker thread of its own, in which case the
+// parsing happens there, and only the parsed bundles are handed over (in
+// order) to the handler. start() is called in the thread the transport lives
+// in.
+class QTuioTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    QTuioTransport(const QTuioPacketFilter &filter, QTuioStats *stats);
+
+    // Also time the parsing of every bundle, see QTuioPacketTimes.
+    void setTracing(bool tracing) { m_tracing = tracing; }
+
+    // Passes every packet that gets through the filter on to destinations,
+    // byte for byte, see QTuioForwarder.
+    void setForwardDestinations(const QTuioEndpointList &destinations) { m_forwarder.setDestinations(destinations); }
+
+    // Whether start() blocks, waiting for packets, until the thread is asked
+    // to interrupt, so the transport needs a thread of its own.
+    virtual bool isBlocking() const { return false; }
+
+public slots:
+    virtual void start() = 0;
+
+signals:
+    // source identifies the tracker, so that state can be kept separately
+    // for each. times.received is when the packet arrived, see
+    // qt_tuioTimestamp.
+    void bundleReceived(quint64 source, const QOscBundle &bundle, const QTuioPacketTimes &times);
+
+    // A sender seen for the first time, by the address and port it sent
+    // from, and the port it sent to; before any of its bundles.
+    void sourceAdded(quint64 source, const QTuioSenderAddress &sender, quint16 port);
+
+protected:
+    // The buffer to read packets into, qt_tuioMaxPacketSize bytes.
+    char *packetBuffer();
+
+    // The cheap checks, on the raw packet: whether it looks like a bundle,
+    // and whether sender (if given; transports that can only be reached from
+    // this host have none) is on the allow-list.
+    bool screenPacket(const char *data, qint64 size, const QTuioSenderAddress *sender);
+
+    // The rest: the rate limit, forwarding and parsing.
+    void parsePacket(const char *data, qint64 size, quint64 source, qint64 timestamp);
+
+    void processPacket(const char *data, qint64 size, quint64 source, qint64 timestamp)
+    {
+        if (screenPacket(data, size, 0))
+            parsePacket(data, size, source, timestamp);
+    }
+
+    // A source key no other source of any transport has: the transport's
+    // number in the upper half, a count in the lower.
+    quint64 newSource() { return (quint64(m_id) << 32) | ++m_sourceCount; }
+
+    QTuioStats *m_stats;
+
+private:
+    quint32 m_id;
+    quint32 m_sourceCount;
+    QByteArray m_buffer;
+    QTuioPacketFilter m_filter;
+    bool m_tracing;
+    QTuioForwarder m_forwarder;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOTRANSPORT_P_H
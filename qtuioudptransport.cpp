@@ -0,0 +1,380 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QDebug>
+
+#if defined(Q_OS_UNIX)
+#include <QSocketNotifier>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <QUdpSocket>
+#endif
+
+#include "qtuioudptransport_p.h"
+#include "qtuiostats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// How many senders a socket keeps track of at once.
+static const int qt_tuioMaxSenders = 64;
+
+QTuioUdpTransport::QTuioUdpTransport(const QHostAddress &address, quint16 port, const QTuioSocketOptions &options,
+                                     const QTuioPacketFilter &filter, QTuioStats *stats)
+    : QTuioTransport(filter, stats)
+    , m_address(address)
+    , m_port(port)
+    , m_options(options)
+#if defined(Q_OS_UNIX)
+    , m_socketDescriptor(-1)
+    , m_notifier(0)
+    , m_kernelDrops(0)
+#else
+    , m_socket(new QUdpSocket(this))
+#endif
+{
+}
+
+QTuioUdpTransport::~QTuioUdpTransport()
+{
+#if defined(Q_OS_UNIX)
+    delete m_notifier;
+    if (m_socketDescriptor >= 0)
+        ::close(m_socketDescriptor);
+#endif
+}
+
+#if defined(Q_OS_UNIX)
+
+// Binds the socket. This is called in the thread the receiver lives in, so
+// that the socket notifier is created there.
+void QTuioUdpTransport::start()
+{
+    if (!openSocket())
+        return;
+
+    packetBuffer();
+    m_notifier = new QSocketNotifier(m_socketDescriptor, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &QTuioUdpTransport::processPackets);
+}
+
+static void qt_setTuioSocketOption(int fd, int level, int option, int value, const char *name)
+{
+    if (::setsockopt(fd, level, option, &value, sizeof(value)) < 0)
+        qWarning() << "Failed to set" << name << "on TUIO socket: " << qt_error_string(errno);
+}
+
+bool QTuioUdpTransport::openSocket()
+{
+    // listening on any address means IPv4 and IPv6 alike, as it does for
+    // QUdpSocket: an IPv6 socket that also takes IPv4 datagrams (their
+    // senders show up IPv4-mapped). Without IPv6, it's IPv4 only.
+    const bool dualStack = m_address == QHostAddress::Any;
+    bool ipv6 = dualStack || m_address.protocol() == QAbstractSocket::IPv6Protocol;
+    int fd = ::socket(ipv6 ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 && dualStack && errno == EAFNOSUPPORT) {
+        ipv6 = false;
+        fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    }
+    if (fd < 0) {
+        qWarning() << "Failed to create TUIO socket: " << qt_error_string(errno);
+        return false;
+    }
+
+    if (ipv6 && dualStack)
+        qt_setTuioSocketOption(fd, IPPROTO_IPV6, IPV6_V6ONLY, 0, "IPV6_V6ONLY");
+
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    // QUdpSocket can't set SO_REUSEPORT (ShareAddress only gets us
+    // SO_REUSEADDR, which for unicast UDP delivers everything to the last
+    // socket bound). With it, the kernel spreads the incoming datagrams over
+    // all sockets bound to the port by a hash of their addresses and ports,
+    // always picking the same socket for the same sender address and port.
+    if (m_options.reusePort) {
+#if defined(SO_REUSEPORT)
+        qt_setTuioSocketOption(fd, SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT");
+#else
+        qWarning() << "SO_REUSEPORT is not supported on this platform, binding a shared socket instead";
+        qt_setTuioSocketOption(fd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+#endif
+    }
+
+    // with bursty traffic from several trackers, the default buffer may
+    // overflow; the kernel then drops datagrams, see SO_RXQ_OVFL below.
+    if (m_options.receiveBufferSize > 0)
+        qt_setTuioSocketOption(fd, SOL_SOCKET, SO_RCVBUF, m_options.receiveBufferSize, "SO_RCVBUF");
+
+    if (m_options.busyPoll > 0) {
+#if defined(SO_BUSY_POLL)
+        qt_setTuioSocketOption(fd, SOL_SOCKET, SO_BUSY_POLL, m_options.busyPoll, "SO_BUSY_POLL");
+#else
+        qWarning() << "SO_BUSY_POLL is not supported on this platform";
+#endif
+    }
+
+    if (!m_options.interfaceName.isEmpty()) {
+#if defined(SO_BINDTODEVICE)
+        if (::setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, m_options.interfaceName.constData(), m_options.interfaceName.size()) < 0)
+            qWarning() << "Failed to bind TUIO socket to" << m_options.interfaceName << ":" << qt_error_string(errno);
+#else
+        qWarning() << "Binding to an interface is not supported on this platform";
+#endif
+    }
+
+#if defined(SO_RXQ_OVFL)
+    // have the number of datagrams the kernel dropped on this socket handed
+    // to us along with every datagram, so we can tell whether we lose
+    // datagrams on the network, or because we're not reading fast enough.
+    qt_setTuioSocketOption(fd, SOL_SOCKET, SO_RXQ_OVFL, 1, "SO_RXQ_OVFL");
+#endif
+
+#if defined(SO_TIMESTAMPNS)
+    // have the kernel tell us when each datagram arrived, rather than
+    // finding out when we get around to reading it.
+    qt_setTuioSocketOption(fd, SOL_SOCKET, SO_TIMESTAMPNS, 1, "SO_TIMESTAMPNS");
+#endif
+
+    int result;
+    if (ipv6) {
+        sockaddr_in6 sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin6_family = AF_INET6;
+        sa.sin6_port = htons(m_port);
+        if (dualStack) {
+            sa.sin6_addr = in6addr_any;
+        } else {
+            Q_IPV6ADDR address = m_address.toIPv6Address();
+            memcpy(&sa.sin6_addr, &address, sizeof(address));
+        }
+        result = ::bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa));
+    } else {
+        sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(m_port);
+        sa.sin_addr.s_addr = m_address == QHostAddress::Any ? htonl(INADDR_ANY) : htonl(m_address.toIPv4Address());
+        result = ::bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa));
+    }
+
+    if (result < 0) {
+        qWarning() << "Failed to bind TUIO socket: " << qt_error_string(errno);
+        ::close(fd);
+        return false;
+    }
+
+    m_socketDescriptor = fd;
+    return true;
+}
+
+void QTuioUdpTransport::processPackets()
+{
+    sockaddr_storage senderAddress;
+    iovec iov;
+    iov.iov_base = packetBuffer();
+    iov.iov_len = qt_tuioMaxPacketSize;
+
+    // room for the ancillary data we asked for
+    union {
+        cmsghdr header;
+        char data[CMSG_SPACE(sizeof(quint32)) + CMSG_SPACE(sizeof(timespec))];
+    } control;
+
+    for (;;) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &senderAddress;
+        msg.msg_namelen = sizeof(senderAddress);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = &control;
+        msg.msg_controllen = sizeof(control);
+
+        const ssize_t size = ::recvmsg(m_socketDescriptor, &msg, MSG_DONTWAIT);
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                qWarning() << "Failed to read from TUIO socket: " << qt_error_string(errno);
+            return;
+        }
+
+        qint64 timestamp = qt_tuioTimestamp();
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+#if defined(SO_TIMESTAMPNS)
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                // that's wall clock time, so move it over to our clock by
+                // how long ago it was.
+                timespec received;
+                timespec now;
+                memcpy(&received, CMSG_DATA(cmsg), sizeof(received));
+                ::clock_gettime(CLOCK_REALTIME, &now);
+                const qint64 age = (now.tv_sec - received.tv_sec) * Q_INT64_C(1000000000) + (now.tv_nsec - received.tv_nsec);
+                if (age > 0)
+                    timestamp -= age;
+            }
+#endif
+#if defined(SO_RXQ_OVFL)
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                // a running total for this socket; the stats want the total
+                // for all of them.
+                quint32 drops;
+                memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                qt_tuioCount(m_stats->kernelDrops, drops - m_kernelDrops);
+                m_kernelDrops = drops;
+            }
+#endif
+        }
+
+        if (msg.msg_flags & MSG_TRUNC) {
+            qt_tuioCount(m_stats->datagrams);
+            qt_tuioCount(m_stats->rejectedMalformed);
+            continue;
+        }
+
+        // (not a QHostAddress, that would allocate for every datagram,
+        // including those we're about to throw away)
+        QTuioSenderAddress sender;
+        if (senderAddress.ss_family == AF_INET6) {
+            const sockaddr_in6 *sa = reinterpret_cast<const sockaddr_in6 *>(&senderAddress);
+            sender = QTuioSenderAddress::fromIPv6(sa->sin6_addr.s6_addr, ntohs(sa->sin6_port));
+        } else {
+            const sockaddr_in *sa = reinterpret_cast<const sockaddr_in *>(&senderAddress);
+            sender = QTuioSenderAddress::fromIPv4(ntohl(sa->sin_addr.s_addr), ntohs(sa->sin_port));
+        }
+        processDatagram(size, sender, timestamp);
+    }
+}
+
+#else
+
+void QTuioUdpTransport::start()
+{
+    if (m_options.reusePort)
+        qWarning() << "SO_REUSEPORT is not supported on this platform, binding a shared socket instead";
+    if (m_options.busyPoll > 0 || !m_options.interfaceName.isEmpty())
+        qWarning() << "Busy polling and binding to an interface are not supported on this platform";
+
+    QUdpSocket::BindMode mode = m_options.reusePort ? QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint
+                                                    : QUdpSocket::DefaultForPlatform;
+    if (!m_socket->bind(m_address, m_port, mode)) {
+        qWarning() << "Failed to bind TUIO socket: " << m_socket->errorString();
+        return;
+    }
+
+    if (m_options.receiveBufferSize > 0)
+        m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, m_options.receiveBufferSize);
+
+    packetBuffer();
+    connect(m_socket, &QUdpSocket::readyRead, this, &QTuioUdpTransport::processPackets);
+}
+
+void QTuioUdpTransport::processPackets()
+{
+    while (m_socket->hasPendingDatagrams()) {
+        QHostAddress sender;
+        quint16 senderPort;
+
+        qint64 size = m_socket->readDatagram(packetBuffer(), qt_tuioMaxPacketSize,
+                                             &sender, &senderPort);
+
+        if (size == -1)
+            continue;
+
+        processDatagram(size, QTuioSenderAddress::fromHostAddress(sender, senderPort), qt_tuioTimestamp());
+    }
+}
+
+#endif
+
+// Handles the datagram that was just read into the packet buffer.
+void QTuioUdpTransport::processDatagram(qint64 size, const QTuioSenderAddress &sender, qint64 timestamp)
+{
+    if (!screenPacket(packetBuffer(), size, &sender))
+        return;
+
+    const quint64 source = this->source(sender, timestamp);
+    if (!source) {
+        qt_tuioCount(m_stats->rejectedSender);
+        return;
+    }
+
+    parsePacket(packetBuffer(), size, source, timestamp);
+}
+
+// The source key of a sender, or 0 if there are too many already. The sender
+// port is part of it: with SO_REUSEPORT, only datagrams from the same address
+// and port are sure to end up on the same socket (and so, to be processed in
+// order).
+//
+// A sender that was quiet for qt_tuioSourceTimeout gets a new key, as the
+// handler will have forgotten about the old one by the time it is back.
+quint64 QTuioUdpTransport::source(const QTuioSenderAddress &sender, qint64 timestamp)
+{
+    QHash<QTuioSenderAddress, Sender>::Iterator it = m_senders.find(sender);
+    if (it != m_senders.end() && timestamp - it->lastSeen < qt_tuioSourceTimeout) {
+        it->lastSeen = timestamp;
+        return it->source;
+    }
+
+    if (it == m_senders.end()) {
+        // don't let a stream of (spoofed) senders grow this without bounds
+        if (m_senders.size() >= qt_tuioMaxSenders) {
+            for (it = m_senders.begin(); it != m_senders.end();) {
+                if (timestamp - it->lastSeen >= qt_tuioSourceTimeout)
+                    it = m_senders.erase(it);
+                else
+                    ++it;
+            }
+            if (m_senders.size() >= qt_tuioMaxSenders)
+                return 0;
+        }
+        it = m_senders.insert(sender, Sender());
+    }
+
+    it->source = newSource();
+    it->lastSeen = timestamp;
+    emit sourceAdded(it->source, sender, m_port);
+    return it->source;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOUDPTRANSPORT_P_H
+#define QTUIOUDPTRANSPORT_P_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+
+#include "qtuiotransport_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QUdpSocket;
+class QSocketNotifier;
+
+struct QTuioSocketOptions
+{
+    QTuioSocketOptions()
+        : reusePort(false)
+        , receiveBufferSize(0)
+        , busyPoll(0)
+    {
+    }
+
+    bool reusePort;           // SO_REUSEPORT
+    int receiveBufferSize;    // SO_RCVBUF, in bytes; 0 for the default
+    int busyPoll;             // SO_BUSY_POLL, in microseconds; 0 for none
+    QByteArray interfaceName; // SO_BINDTODEVICE
+};
+
+// Reads TUIO datagrams from one UDP socket. Each sender address and port
+// (together with the port it sends to) is a source of its own.
+//
+// On Unix, the socket is created and read natively, as QUdpSocket neither
+// lets us set most of the socket options, nor gives us the ancillary data
+// (like the kernel's drop counter) that comes with a datagram.
+class QTuioUdpTransport : public QTuioTransport
+{
+    Q_OBJECT
+
+public:
+    QTuioUdpTransport(const QHostAddress &address, quint16 port, const QTuioSocketOptions &options,
+                      const QTuioPacketFilter &filter, QTuioStats *stats);
+    ~QTuioUdpTransport();
+
+public slots:
+    void start();
+
+private slots:
+    void processPackets();
+
+private:
+    void processDatagram(qint64 size, const QTuioSenderAddress &sender, qint64 timestamp);
+    quint64 source(const QTuioSenderAddress &sender, qint64 timestamp);
+
+    QHostAddress m_address;
+    quint16 m_port;
+    QTuioSocketOptions m_options;
+    struct Sender {
+        quint64 source;
+        qint64 lastSeen;
+    };
+    QHash<QTuioSenderAddress, Sender> m_senders;
+#if defined(Q_OS_UNIX)
+    bool openSocket();
+
+    int m_socketDescriptor;
+    QSocketNotifier *m_notifier;
+    quint32 m_kernelDrops;
+#else
+    QUdpSocket *m_socket;
+#endif
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOUDPTRANSPORT_P_H
@@ -0,0 +1,187 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QDebug>
+#include <QFile>
+#include <QSocketNotifier>
+
+#if defined(Q_OS_UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "qtuiounixtransport_p.h"
+#include "qtuiostats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QTuioUnixTransport::QTuioUnixTransport(const QString &path, const QTuioPacketFilter &filter, QTuioStats *stats)
+    : QTuioTransport(filter, stats)
+    , m_path(path)
+    , m_source(newSource())
+    , m_socketDescriptor(-1)
+    , m_notifier(0)
+    , m_boundDevice(0)
+    , m_boundInode(0)
+{
+}
+
+#if defined(Q_OS_UNIX)
+
+QTuioUnixTransport::~QTuioUnixTransport()
+{
+    delete m_notifier;
+    if (m_socketDescriptor >= 0) {
+        ::close(m_socketDescriptor);
+
+        // only if it's still ours, and not another one bound there since
+        const QByteArray path = QFile::encodeName(m_path);
+        struct stat st;
+        if (::lstat(path.constData(), &st) == 0 && S_ISSOCK(st.st_mode) &&
+                quint64(st.st_dev) == m_boundDevice && quint64(st.st_ino) == m_boundInode) {
+            ::unlink(path.constData());
+        }
+    }
+}
+
+// Whether path is a socket left behind by an earlier run: a socket nobody is
+// bound to any more. Anything else is left alone.
+static bool qt_isStaleTuioSocket(const QByteArray &path, const sockaddr_un &sa)
+{
+    struct stat st;
+    if (::lstat(path.constData(), &st) < 0 || !S_ISSOCK(st.st_mode))
+        return false;
+
+    int probe = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (probe < 0)
+        return false;
+    const bool stale = ::connect(probe, reinterpret_cast<const sockaddr *>(&sa), sizeof(sa)) < 0 && errno == ECONNREFUSED;
+    ::close(probe);
+    return stale;
+}
+
+void QTuioUnixTransport::start()
+{
+    const QByteArray path = QFile::encodeName(m_path);
+    sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (path.size() >= int(sizeof(sa.sun_path))) {
+        qWarning() << "TUIO socket path too long: " << m_path;
+        return;
+    }
+    memcpy(sa.sun_path, path.constData(), path.size());
+
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        qWarning() << "Failed to create TUIO socket: " << qt_error_string(errno);
+        return;
+    }
+
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    int result = ::bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa));
+    if (result < 0 && errno == EADDRINUSE && qt_isStaleTuioSocket(path, sa)) {
+        // a socket left behind by an earlier run is in the way
+        ::unlink(path.constData());
+        result = ::bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa));
+    }
+    if (result < 0) {
+        qWarning() << "Failed to bind TUIO socket to" << m_path << ":" << qt_error_string(errno);
+        ::close(fd);
+        return;
+    }
+
+    struct stat st;
+    if (::lstat(path.constData(), &st) == 0) {
+        m_boundDevice = st.st_dev;
+        m_boundInode = st.st_ino;
+    }
+
+    m_socketDescriptor = fd;
+    packetBuffer();
+    m_notifier = new QSocketNotifier(m_socketDescriptor, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &QTuioUnixTransport::processPackets);
+}
+
+void QTuioUnixTransport::processPackets()
+{
+    char *buffer = packetBuffer();
+
+    for (;;) {
+        // MSG_TRUNC makes recv report the full size of a datagram that didn't
+        // fit, rather than what we got of it.
+        const ssize_t size = ::recv(m_socketDescriptor, buffer, qt_tuioMaxPacketSize, MSG_DONTWAIT | MSG_TRUNC);
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                qWarning() << "Failed to read from TUIO socket: " << qt_error_string(errno);
+            return;
+        }
+
+        if (size > qt_tuioMaxPacketSize) {
+            qt_tuioCount(m_stats->datagrams);
+            qt_tuioCount(m_stats->rejectedMalformed);
+            continue;
+        }
+
+        processPacket(buffer, size, m_source, qt_tuioTimestamp());
+    }
+}
+
+#else
+
+QTuioUnixTransport::~QTuioUnixTransport()
+{
+}
+
+void QTuioUnixTransport::start()
+{
+    qWarning() << "Unix sockets are not supported on this platform";
+}
+
+void QTuioUnixTransport::processPackets()
+{
+}
+
+#endif
+
+QT_END_NAMESPACE
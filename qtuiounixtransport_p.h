@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOUNIXTRANSPORT_P_H
+#define QTUIOUNIXTRANSPORT_P_H
+
+#include <QString>
+
+#include "qtuiotransport_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+
+// Reads TUIO packets from a Unix datagram socket (AF_UNIX, SOCK_DGRAM) bound
+// to a path, one packet per datagram. For trackers on the same host that can
+// send to a socket, but don't do shared memory: it skips the IP stack, and
+// no other host can get at it. Everything arriving on the socket is one
+// source.
+//
+// Only supported on Unix.
+class QTuioUnixTransport : public QTuioTransport
+{
+    Q_OBJECT
+
+public:
+    QTuioUnixTransport(const QString &path, const QTuioPacketFilter &filter, QTuioStats *stats);
+    ~QTuioUnixTransport();
+
+public slots:
+    void start();
+
+private slots:
+    void processPackets();
+
+private:
+    QString m_path;
+    quint64 m_source;
+    int m_socketDescriptor;
+    QSocketNotifier *m_notifier;
+    // the socket file bound, so it's only removed if it's still ours
+    quint64 m_boundDevice;
+    quint64 m_boundInode;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOUNIXTRANSPORT_P_H
@@ -0,0 +1,192 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QGuiApplication>
+#include <QScreen>
+#include <QEvent>
+#include <QDebug>
+
+#include "qtuiowindowindex_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QTuioWindowIndex::QTuioWindowIndex(const QString &screenSpec, QObject *parent)
+    : QObject(parent)
+    , m_screenSpec(screenSpec)
+    , m_dirty(true)
+{
+    qApp->installEventFilter(this);
+    connect(qApp, &QGuiApplication::screenAdded, this, &QTuioWindowIndex::invalidate);
+    connect(qApp, &QGuiApplication::screenRemoved, this, &QTuioWindowIndex::invalidate);
+    connect(qApp, &QGuiApplication::primaryScreenChanged, this, &QTuioWindowIndex::invalidate);
+}
+
+QScreen *QTuioWindowIndex::screen() const
+{
+    QList<QScreen *> screens = QGuiApplication::screens();
+
+    bool isIndex = false;
+    int index = m_screenSpec.toInt(&isIndex);
+    if (isIndex && index >= 0 && index < screens.count())
+        return screens.at(index);
+
+    foreach (QScreen *screen, screens) {
+        if (screen->name() == m_screenSpec)
+            return screen;
+    }
+
+    if (!m_screenSpec.isEmpty() && m_screenSpec != QLatin1String("virtual"))
+        qWarning() << "TUIO screen" << m_screenSpec << "not found, using the primary screen";
+
+    return QGuiApplication::primaryScreen();
+}
+
+QRect QTuioWindowIndex::targetGeometry()
+{
+    if (m_dirty)
+        rebuild();
+    return m_geometry;
+}
+
+QWindow *QTuioWindowIndex::windowAt(const QPoint &globalPos)
+{
+    if (m_dirty)
+        rebuild();
+
+    if (!m_geometry.contains(globalPos) || m_geometry.isEmpty())
+        return 0;
+
+    const int column = (globalPos.x() - m_geometry.x()) * GridSize / m_geometry.width();
+    const int row = (globalPos.y() - m_geometry.y()) * GridSize / m_geometry.height();
+    const QVector<int> &cell = m_cells[row * GridSize + column];
+
+    for (int i = 0; i < cell.count(); ++i) {
+        const Entry &entry = m_entries.at(cell.at(i));
+        if (entry.window && entry.geometry.contains(globalPos))
+            return entry.window.data();
+    }
+
+    return 0;
+}
+
+void QTuioWindowIndex::invalidate()
+{
+    m_dirty = true;
+}
+
+bool QTuioWindowIndex::eventFilter(QObject *object, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::FocusIn:
+        if (object->isWindowType()) {
+            // we can't ask for the stacking order, so we assume the windows
+            // activated most recently are the ones on top.
+            QWindow *window = static_cast<QWindow *>(object);
+            m_activationOrder.removeAll(window);
+            m_activationOrder.prepend(window);
+            m_dirty = true;
+        }
+        break;
+    case QEvent::Show:
+    case QEvent::Hide:
+    case QEvent::Move:
+    case QEvent::Resize:
+        if (object->isWindowType())
+            m_dirty = true;
+        break;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+void QTuioWindowIndex::rebuild()
+{
+    m_dirty = false;
+
+    QScreen *screen = this->screen();
+    if (!screen) {
+        m_geometry = QRect();
+        return;
+    }
+    m_geometry = m_screenSpec == QLatin1String("virtual") ? screen->virtualGeometry() : screen->geometry();
+    connect(screen, &QScreen::geometryChanged, this, &QTuioWindowIndex::invalidate, Qt::UniqueConnection);
+    connect(screen, &QScreen::virtualGeometryChanged, this, &QTuioWindowIndex::invalidate, Qt::UniqueConnection);
+
+    m_activationOrder.removeAll(QPointer<QWindow>());
+
+    // topmost first: recently activated windows, then the rest, newest first.
+    QList<QWindow *> windows = QGuiApplication::topLevelWindows();
+    QVector<QWindow *> ordered;
+    ordered.reserve(windows.count());
+    foreach (const QPointer<QWindow> &window, m_activationOrder) {
+        if (windows.contains(window.data()))
+            ordered.append(window.data());
+    }
+    for (int i = windows.count() - 1; i >= 0; --i) {
+        if (!ordered.contains(windows.at(i)))
+            ordered.append(windows.at(i));
+    }
+
+    m_entries.clear();
+    for (int i = 0; i < GridSize * GridSize; ++i)
+        m_cells[i].clear();
+
+    foreach (QWindow *window, ordered) {
+        if (!window->isVisible() || (window->flags() & Qt::WindowTransparentForInput))
+            continue;
+
+        Entry entry;
+        entry.window = window;
+        entry.geometry = window->geometry();
+        QRect overlap = entry.geometry & m_geometry;
+        if (overlap.isEmpty())
+            continue;
+
+        const int index = m_entries.count();
+        m_entries.append(entry);
+
+        const int left = (overlap.left() - m_geometry.x()) * GridSize / m_geometry.width();
+        const int right = (overlap.right() - m_geometry.x()) * GridSize / m_geometry.width();
+        const int top = (overlap.top() - m_geometry.y()) * GridSize / m_geometry.height();
+        const int bottom = (overlap.bottom() - m_geometry.y()) * GridSize / m_geometry.height();
+        for (int row = top; row <= bottom; ++row) {
+            for (int column = left; column <= right; ++column)
+                m_cells[row * GridSize + column].append(index);
+        }
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,100 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Robin Burchell <robin.burchell@viroteck.net>
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtCore module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QTUIOWINDOWINDEX_P_H
+#define QTUIOWINDOWINDEX_P_H
+
+#include <QObject>
+#include <QPointer>
+#include <QRect>
+#include <QVector>
+#include <QWindow>
+
+QT_BEGIN_NAMESPACE
+
+class QScreen;
+
+// Finds the top-level window under a point on the screen, without asking the
+// platform (which may mean a round trip to the window server) for every touch.
+//
+// The visible top-level windows are sorted into a coarse grid of cells, each
+// cell holding the windows overlapping it, topmost first. The grid is only
+// rebuilt (on the next lookup) after windows have been shown, hidden, moved,
+// resized or activated, or screens have come or gone, so the cost of a lookup
+// doesn't depend on how many windows there are.
+//
+// Qt has no way to ask for the stacking order of the windows, so where they
+// overlap, the one activated most recently is assumed to be on top (and, of
+// windows never activated, the one created last).
+class QTuioWindowIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    // screenSpec is a screen index, a screen name, or "virtual" for the whole
+    // virtual desktop; empty means the primary screen.
+    explicit QTuioWindowIndex(const QString &screenSpec, QObject *parent = 0);
+
+    // The area normalized coordinates are mapped into.
+    QRect targetGeometry();
+
+    QWindow *windowAt(const QPoint &globalPos);
+
+    bool eventFilter(QObject *object, QEvent *event) Q_DECL_OVERRIDE;
+
+private slots:
+    void invalidate();
+
+private:
+    enum { GridSize = 16 };
+
+    struct Entry {
+        QPointer<QWindow> window;
+        QRect geometry;
+    };
+
+    void rebuild();
+    QScreen *screen() const;
+
+    QString m_screenSpec;
+    bool m_dirty;
+    QRect m_geometry;
+    QVector<Entry> m_entries;
+    QVector<int> m_cells[GridSize * GridSize];
+    QVector<QPointer<QWindow> > m_activationOrder;
+};
+
+QT_END_NAMESPACE
+
+#endif // QTUIOWINDOWINDEX_P_H
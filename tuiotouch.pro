@@ -14,13 +14,43 @@ SOURCES += \
     main.cpp \
     qoscbundle.cpp \
     qoscmessage.cpp \
-    qtuiohandler.cpp
+    qoscwriter.cpp \
+    qtuiocalibration.cpp \
+    qtuioforwarder.cpp \
+    qtuiohandler.cpp \
+    qtuiopacketfilter.cpp \
+    qtuiotrace.cpp \
+    qtuiotransport.cpp \
+    qtuioudptransport.cpp \
+    qtuiounixtransport.cpp \
+    qtuioshmtransport.cpp \
+    qtuiosliptransport.cpp \
+    qtuiowindowindex.cpp
 
 HEADERS += \
     qoscbundle_p.h \
     qoscmessage_p.h \
+    qoscwriter_p.h \
+    qtuioforwarder_p.h \
     qtuiohandler_p.h \
+    qtuioidallocator_p.h \
+    qtuiopacketfilter_p.h \
+    qtuiostats_p.h \
+    qtuioudptransport_p.h \
+    qtuioshmtransport_p.h \
+    qtuiosliptransport_p.h \
+    qtuiotransport_p.h \
+    qtuiounixtransport_p.h \
+    qtuiowindowindex_p.h \
+    qtuiotransform_p.h \
+    qtuiocalibration_p.h \
+    qtuiofilter_p.h \
+    qtuiokinematics_p.h \
+    qtuiotrace_p.h \
+    qtuiosnapshot.h \
     qtuiocursor_p.h
 
 OTHER_FILES += \
     tuiotouch.json
+
+linux: LIBS += -lrt